@@ -0,0 +1,131 @@
+// motor controller for an arduino mega 2560 driving two step/dir drivers.
+//
+// setpoint frames from the planner arrive on Serial at 115200 baud and
+// are queued; loop() plans each into a period of steps and the timer1
+// compare interrupt plays them, answering the host with credits the way
+// 5bar_vcontroller does. the joints are taken to be at the first
+// setpoint's pose when the board starts, as after homing. the logic is in
+// the .cpp files next to this one, which also build on the host for
+// firmware_bench
+
+#include <Arduino.h>
+#include "firmware.h"
+#include "frames.h"
+#include "interpolator.h"
+#include "queues.h"
+#include "step_isr.h"
+
+using namespace firmware;
+
+// d22..d25 are pa0..pa3: step theta1, step theta2, dir theta1, dir theta2
+const uint8_t STEP_MASK = 0x03;
+const uint8_t DIR_MASK = 0x0c;
+
+const unsigned long CREDIT_EVERY = 5;   // ms, credits also go out on every frame taken
+const unsigned long NAK_HOLDOFF = 10;   // ms between naks
+
+SetpointRing ring;
+SegmentQueue segments;
+FrameReceiver receiver(ring);
+Interpolator interpolator;
+StepGenerator generator(segments);
+
+bool homed = false;
+volatile uint8_t pending = 0;   // step lines to raise on the next compare match
+
+ISR(TIMER1_COMPA_vect)
+{
+    PORTA |= pending;
+
+    uint16_t delay = generator.tick();
+    OCR1A += delay;
+
+    PORTA = (PORTA & ~(STEP_MASK | DIR_MASK)) | (generator.direction() << 2);
+    pending = generator.steps();
+}
+
+static uint16_t Depth()
+{
+    return ring.size() + segments.size();
+}
+
+static uint16_t Underruns()
+{
+    noInterrupts();
+    uint16_t n = generator.underruns();
+    interrupts();
+
+    return n;
+}
+
+void setup()
+{
+    DDRA |= STEP_MASK | DIR_MASK;
+    PORTA &= ~(STEP_MASK | DIR_MASK);
+
+    Serial.begin(115200);
+
+    // timer1 free running at 16 MHz / 8, compare a moves ahead of it
+    noInterrupts();
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);
+    OCR1A = TCNT1 + PERIOD_TICKS;
+    TIMSK1 |= _BV(OCIE1A);
+    interrupts();
+}
+
+void loop()
+{
+    static unsigned long lastCredit = 0, lastNak = 0;
+    uint8_t reply[REPLY_MAX];
+
+    while (Serial.available())
+    {
+        uint8_t answer = receiver.feed((uint8_t)Serial.read());
+
+        // the segments planned from the old queue go too, and their steps
+        // come off the interpolator's count, so a reconnect does not move
+        // every later target by the steps that never played
+        if (receiver.takeReset())
+        {
+            StepSegment s;
+
+            noInterrupts();
+            while (generator.unqueue(s)) interpolator.unplan(s);
+            interrupts();
+        }
+
+        if (answer == REPLY_CREDIT)
+        {
+            Serial.write(reply, receiver.credit(Depth(), Underruns(), reply));
+            lastCredit = millis();
+        }
+        else if (answer == REPLY_NAK && millis() - lastNak >= NAK_HOLDOFF)
+        {
+            Serial.write(reply, receiver.nak(reply));
+            lastNak = millis();
+        }
+    }
+
+    // keep the interrupt a few periods ahead
+    Setpoint sp;
+
+    while (!segments.full() && ring.pop(sp))
+    {
+        if (!homed)
+        {
+            interpolator.reset(sp.theta1, sp.theta2);
+            homed = true;
+        }
+
+        StepSegment s;
+        interpolator.plan(sp, s);
+        segments.push(s);
+    }
+
+    if (millis() - lastCredit >= CREDIT_EVERY)
+    {
+        Serial.write(reply, receiver.credit(Depth(), Underruns(), reply));
+        lastCredit = millis();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+
+// the motor controller's side of the link. it builds with avr-gcc for an
+// arduino mega and with the host compiler for firmware_bench, so there is
+// no heap, nothing from the standard library past stdint and no integer
+// wider than 32 bits. everything the step interrupt runs is additions and
+// compares, the divides happen once a control period in loop(). it is all
+// in a namespace so the bench can hold it next to the host's own headers
+
+namespace firmware
+{
+
+// the step timer: timer1 of the atmega2560 at 16 MHz / 8
+const uint32_t TIMER_HZ = 2000000;
+
+// setpoints arrive one a control tick, each is played over one period
+const uint16_t CONTROL_HZ = 1000;
+const uint16_t PERIOD_TICKS = TIMER_HZ / CONTROL_HZ;
+
+// encoder counts a joint turn on the wire, and microsteps a joint turn:
+// 200 step motors at 16 microsteps through 4:1 belts. the same as
+// ENCODER_COUNTS and STEPPERS in code/src
+const int32_t ENCODER_COUNTS = 16384;
+const int32_t MICROSTEPS = 12800;
+
+// microsteps = counts * 25 / 32, kept small so 32 bits hold many turns
+const int32_t STEPS_NUM = 25;
+const int32_t STEPS_DEN = 32;
+static_assert(STEPS_NUM * ENCODER_COUNTS == STEPS_DEN * MICROSTEPS, "microstep ratio");
+
+// closest two fires of the step timer may come, the drivers take 100 khz
+// and the worst fire needs most of it. a period's first step comes half a
+// slice after the fire starting it and the fire ending it half a slice
+// after its last, so the clamp holds half a slice to MIN_STEP_TICKS: 50k
+// steps a second, twice the transit limit. a period asking for more steps
+// takes what fits and the rest follow
+const uint16_t MIN_STEP_TICKS = 20;
+const uint16_t MAX_PERIOD_STEPS = PERIOD_TICKS / (2 * MIN_STEP_TICKS);
+static_assert(PERIOD_TICKS / (2 * MAX_PERIOD_STEPS) >= MIN_STEP_TICKS, "period ends");
+
+// setpoints the queue holds, a power of two. 512 are 2.5 kB of the 8
+const uint16_t QUEUE_SETPOINTS = 512;
+
+// step segments planned ahead of the interrupt, a power of two
+const uint8_t QUEUE_SEGMENTS = 4;
+
+// the last setpoint of a trajectory, the queue may run dry after it
+const uint8_t SETPOINT_END = 0x01;
+
+struct Setpoint
+{
+    int16_t theta1;   // encoder counts, wrapping at half a turn
+    int16_t theta2;
+    uint8_t flags;
+};
+
+// one control period of steps, timed as the host's StepTimeline does: the
+// joint with the most steps takes them in the middle of major equal
+// slices, the other on the slices its bresenham error carries over. the
+// slice times are a dda too, step i is at (2i + 1) PERIOD_TICKS / 2 major
+struct StepSegment
+{
+    uint16_t count[2];
+    uint16_t major;
+    uint8_t dir;          // bit 0 for theta1 and bit 1 for theta2 turning positive
+    uint8_t flags;
+    uint16_t first;       // ticks to the first step
+    uint16_t interval;    // ticks between steps, plus one on a carry
+    uint16_t carry;       // added to the time remainder each step
+    uint16_t modulus;     // 2 major, where the remainder carries
+    uint16_t remainder;   // the first step's
+};
+
+// firmware_bench counts the primitive operations (a load, store, add,
+// compare or branch) on every path the step interrupt and the interpolator
+// take. the board build compiles the counts away
+#ifdef FIRMWARE_COUNT_OPS
+extern uint32_t countedOps;
+extern uint8_t countedPath;
+#define FW_OPS(n) (::firmware::countedOps += (n))
+#define FW_PATH(p) (::firmware::countedPath = (p))
+#else
+#define FW_OPS(n) ((void)0)
+#define FW_PATH(p) ((void)0)
+#endif
+
+// keeps the compiler from moving loads and stores across it, so a queue
+// slot is written before the index that hands it over. one core, so
+// nothing more is needed
+#define FW_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// a 16 bit divide, quotient and remainder, is a library call of some 200
+// cycles on the avr
+const uint32_t DIVIDE_OPS = 100;
+
+} // namespace firmware
@@ -0,0 +1,140 @@
+#include "fixed_ik.h"
+#include "ik_tables.h"
+
+namespace firmware
+{
+
+uint32_t SqrtFixed(uint32_t v, uint8_t fraction)
+{
+    // digit by digit, two bits of v a round and then pairs of zeros for
+    // the fraction. the remainder stays under 2 root + 1
+    uint32_t root = 0, remainder = 0;
+
+    for (uint8_t i = 0; i < 16 + fraction; i++)
+    {
+        remainder = (remainder << 2) | (i < 16 ? (v >> 30) : 0);
+        v <<= 2;
+        root <<= 1;
+
+        uint32_t trial = (root << 1) | 1;
+        FW_OPS(8);
+
+        if (remainder >= trial)
+        {
+            remainder -= trial;
+            root |= 1;
+            FW_OPS(2);
+        }
+    }
+
+    return root;
+}
+
+uint32_t Atan2Turns(int32_t y, int32_t x)
+{
+    uint32_t angle = 0;
+
+    // vectoring only converges for x >= 0, the left half turns round first
+    if (x < 0)
+    {
+        x = -x;
+        y = -y;
+        angle = 0x80000000ul;
+        FW_OPS(3);
+    }
+
+    uint32_t m = (uint32_t)(x > (y < 0 ? -y : y) ? x : (y < 0 ? -y : y));
+    FW_OPS(6);
+    if (!m) return angle;
+
+    // short vectors would lose their bits to the shifts
+    while (m < (1ul << 18))
+    {
+        x <<= 8;
+        y <<= 8;
+        m <<= 8;
+        FW_OPS(4);
+    }
+
+    while (m < (1ul << 26))
+    {
+        x <<= 1;
+        y <<= 1;
+        m <<= 1;
+        FW_OPS(4);
+    }
+
+    // rotate (x, y) onto the x axis, adding up the turns taken
+    for (uint8_t i = 0; i < IK_ITERATIONS; i++)
+    {
+        int32_t dx = x >> i;
+        int32_t dy = y >> i;
+
+        if (y > 0)
+        {
+            x += dy;
+            y -= dx;
+            angle += IK_ATAN[i];
+        }
+        else
+        {
+            x -= dy;
+            y += dx;
+            angle -= IK_ATAN[i];
+        }
+
+        FW_OPS(10);
+    }
+
+    return angle;
+}
+
+// one arm: (rx, ry) from its motor to C, proximal l, k0 = l^2 - m^2. the
+// angle is the direction to C turned toward the elbow, left for theta1
+static bool Arm(int32_t rx, int32_t ry, int32_t l, int32_t k0, uint32_t near, uint32_t far, bool left, uint32_t& angle)
+{
+    uint32_t d2 = (uint32_t)(rx * rx + ry * ry);
+    FW_OPS(5);
+
+    if (!d2 || d2 < near || d2 > far) return false;
+
+    // d to 1/1024 unit and the triangle's sides to 1/2^14, as far as
+    // 2 l d stays in 32 bits at full reach
+    uint32_t d = SqrtFixed(d2, 6);
+    uint32_t twoLD = 2 * (uint32_t)l * d;
+    int32_t k = (k0 + (int32_t)d2) << 6;
+
+    uint32_t a = (int32_t)(twoLD - k) < 0 ? 0 : twoLD - k;
+    uint32_t b = twoLD + k;
+    FW_OPS(12);
+
+    uint32_t half = Atan2Turns((int32_t)SqrtFixed(a, 6), (int32_t)SqrtFixed(b, 6));
+    uint32_t direction = Atan2Turns(ry, rx);
+
+    angle = left ? direction + 2 * half : direction - 2 * half;
+    FW_OPS(4);
+
+    return true;
+}
+
+// 2^32 a turn to the wire's counts, rounded, wrapping at half a turn
+static int16_t Counts(uint32_t angle)
+{
+    FW_OPS(3);
+    return (int16_t)((int32_t)(angle + (1ul << 17)) >> 18);
+}
+
+bool SolveIKFixed(int32_t x, int32_t y, int16_t& theta1, int16_t& theta2)
+{
+    uint32_t a1, a2;
+
+    if (!Arm(x - IK_AX, y - IK_AY, IK_L1, IK_K1, IK_NEAR1, IK_FAR1, true, a1)) return false;
+    if (!Arm(x - IK_EX, y - IK_EY, IK_L4, IK_K2, IK_NEAR2, IK_FAR2, false, a2)) return false;
+
+    theta1 = Counts(a1);
+    theta2 = Counts(a2);
+
+    return true;
+}
+
+} // namespace firmware
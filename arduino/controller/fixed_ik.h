@@ -0,0 +1,36 @@
+#pragma once
+#include "firmware.h"
+
+namespace firmware
+{
+
+// board positions the controller solves for are in 1/16 board units
+const int32_t POSITION_SCALE = 16;
+
+// the elbows out solution of SolveIK in code/src in integers only, for a
+// core with no fpu, straight to encoder counts. each arm's motor angle is
+// the direction to C plus or minus the angle the triangle opens at the
+// motor, and that comes from its half angle,
+//
+//   2 atan2(sqrt(2 l d - k), sqrt(2 l d + k)),  k = l^2 + d^2 - m^2
+//
+// so there is no acos and no divide, just square roots by bits and atan2
+// by cordic, shifts and adds against a generated arctangent table. d is
+// carried to 1/1024 unit and the cordic runs 24 iterations on inputs
+// normalised to 26 bits. fixed_ik_bench sweeps every point of the 1/16
+// grid: against the double reference rounded to counts 98.6% of solves
+// agree on both joints and the rest are a count out, the rounding edge,
+// except for 0.001% within 1/64 unit of full reach, where the arm is
+// straight and both are tens of counts from what the target needs anyway.
+// reach agrees everywhere. about 2400 primitive operations a solve. the
+// arm and tables are in ik_tables.h, from 5bar_ik_tables. positions must
+// be within 2^15 of each motor, in 1/16 units
+bool SolveIKFixed(int32_t x, int32_t y, int16_t& theta1, int16_t& theta2);
+
+// floor(sqrt(v) 2^fraction), fraction up to 10
+uint32_t SqrtFixed(uint32_t v, uint8_t fraction);
+
+// the direction of (x, y), 2^32 a turn. |x| and |y| under 2^27
+uint32_t Atan2Turns(int32_t y, int32_t x);
+
+} // namespace firmware
@@ -0,0 +1,169 @@
+#include "frames.h"
+
+namespace firmware
+{
+
+// crc16 ccitt, 0x1021 from 0xffff, a byte at a time
+static uint16_t Crc16(uint16_t crc, uint8_t b)
+{
+    crc ^= (uint16_t)(b << 8);
+
+    for (uint8_t k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+
+    return crc;
+}
+
+static uint8_t Encode(uint8_t type, uint8_t seq, const uint8_t* payload, uint8_t length, uint8_t* out)
+{
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = type;
+    out[3] = seq;
+    out[4] = length;
+
+    for (uint8_t i = 0; i < length; i++) out[5 + i] = payload[i];
+
+    uint16_t crc = 0xffff;
+    for (uint8_t i = 2; i < 5 + length; i++) crc = Crc16(crc, out[i]);
+
+    out[5 + length] = (uint8_t)crc;
+    out[6 + length] = (uint8_t)(crc >> 8);
+
+    return FRAME_OVERHEAD + length;
+}
+
+uint8_t FrameReceiver::feed(uint8_t b)
+{
+    switch (state)
+    {
+    case SYNC0:
+        if (b == FRAME_SYNC0) state = SYNC1;
+        break;
+
+    case SYNC1:
+        state = b == FRAME_SYNC1 ? TYPE : (b == FRAME_SYNC0 ? SYNC1 : SYNC0);
+        break;
+
+    case TYPE:
+        type = b;
+        crc = Crc16(0xffff, b);
+        state = SEQ;
+        break;
+
+    case SEQ:
+        seq = b;
+        crc = Crc16(crc, b);
+        state = LENGTH;
+        break;
+
+    case LENGTH:
+        length = b;
+        crc = Crc16(crc, b);
+        index = 0;
+        staging = false;
+        count = 0;
+        state = length ? PAYLOAD : CRC_LO;
+        break;
+
+    case PAYLOAD:
+        crc = Crc16(crc, b);
+        payload(b);
+        if (++index == length) state = CRC_LO;
+        break;
+
+    case CRC_LO:
+        received = b;
+        state = CRC_HI;
+        break;
+
+    case CRC_HI:
+        received |= (uint16_t)(b << 8);
+        state = SYNC0;
+
+        if (received == crc) return finish();
+
+        errors++;
+        break;
+    }
+
+    return REPLY_NONE;
+}
+
+void FrameReceiver::payload(uint8_t b)
+{
+    if (type != FRAME_SETPOINTS) return;
+
+    if (index == 0)
+    {
+        flags = b;
+        return;
+    }
+
+    if (index == 1)
+    {
+        // only a frame that fits where the ring has room is written out
+        count = b;
+        staging = count <= BATCH_SETPOINTS && length == 2 + 4 * count && count <= ring.space();
+        return;
+    }
+
+    if (!staging) return;
+
+    uint8_t k = (uint8_t)((index - 2) >> 2);
+    Setpoint& sp = ring.staged(k);
+
+    switch ((index - 2) & 3)
+    {
+    case 0: sp.theta1 = (int16_t)b; break;
+    case 1: sp.theta1 = (int16_t)((uint16_t)sp.theta1 | (uint16_t)(b << 8)); break;
+    case 2: sp.theta2 = (int16_t)b; break;
+    case 3:
+        sp.theta2 = (int16_t)((uint16_t)sp.theta2 | (uint16_t)(b << 8));
+        sp.flags = (k + 1 == count && (flags & SETPOINTS_END)) ? SETPOINT_END : 0;
+        break;
+    }
+}
+
+uint8_t FrameReceiver::finish()
+{
+    if (type == FRAME_RESET)
+    {
+        ring.clear();
+        expected = (uint8_t)(seq + 1);
+        resetting = true;
+        return REPLY_CREDIT;
+    }
+
+    if (type != FRAME_SETPOINTS || length < 2 || count > BATCH_SETPOINTS || length != 2 + 4 * count) return REPLY_NONE;
+
+    if (seq == expected && staging)
+    {
+        ring.publish(count);
+        expected++;
+        return REPLY_CREDIT;
+    }
+
+    // a resent frame already taken, the credit tells the host
+    if ((uint8_t)(expected - seq) < 128 && seq != expected) return REPLY_CREDIT;
+
+    // a gap, or more than the credits allowed
+    if (seq == expected) over++;
+
+    return REPLY_NAK;
+}
+
+uint8_t FrameReceiver::credit(uint16_t depth, uint16_t underruns, uint8_t* out) const
+{
+    uint16_t free = ring.space();
+    uint8_t payload[7] = {(uint8_t)(expected - 1), (uint8_t)free, (uint8_t)(free >> 8), (uint8_t)depth,
+                          (uint8_t)(depth >> 8), (uint8_t)underruns, (uint8_t)(underruns >> 8)};
+
+    return Encode(FRAME_CREDIT, 0, payload, sizeof(payload), out);
+}
+
+uint8_t FrameReceiver::nak(uint8_t* out) const
+{
+    return Encode(FRAME_NAK, expected, 0, 0, out);
+}
+
+} // namespace firmware
@@ -0,0 +1,89 @@
+#pragma once
+#include "firmware.h"
+#include "queues.h"
+
+namespace firmware
+{
+
+// the controller's end of the framed link in code/src/protocol.h, which
+// has the frame layout. the values here must stay the same as there,
+// firmware_bench checks they do
+const uint8_t FRAME_SYNC0 = 0xa5;
+const uint8_t FRAME_SYNC1 = 0x5a;
+const uint8_t FRAME_OVERHEAD = 7;
+
+const uint8_t FRAME_RESET = 0x01;
+const uint8_t FRAME_SETPOINTS = 0x02;
+const uint8_t FRAME_CREDIT = 0x81;
+const uint8_t FRAME_NAK = 0x82;
+
+const uint8_t BATCH_SETPOINTS = 32;
+const uint8_t SETPOINTS_END = 0x01;
+
+// bytes a reply can take
+const uint8_t REPLY_MAX = FRAME_OVERHEAD + 7;
+
+// what the host is owed after a byte
+enum Reply : uint8_t
+{
+    REPLY_NONE = 0,
+    REPLY_CREDIT,
+    REPLY_NAK,
+};
+
+// byte at a time, resynchronising on the sync pair after a bad frame. a
+// setpoint frame is decoded straight into the ring past its head as it
+// arrives, and published when the crc checks and it is the frame expected
+// next, so ram holds the queue and nothing else. the rules are the ones
+// 5bar_vcontroller plays by
+class FrameReceiver
+{
+public:
+    explicit FrameReceiver(SetpointRing& ring) : ring(ring) {}
+
+    uint8_t feed(uint8_t b);
+
+    // true once after a reset frame: the segments planned from the old
+    // queue have to go too
+    bool takeReset()
+    {
+        bool r = resetting;
+        resetting = false;
+        return r;
+    }
+
+    // replies, out has room for REPLY_MAX bytes. depth counts setpoints
+    // queued anywhere, the ring's space is the credit
+    uint8_t credit(uint16_t depth, uint16_t underruns, uint8_t* out) const;
+    uint8_t nak(uint8_t* out) const;
+
+    uint16_t crcErrors() const { return errors; }
+    uint16_t overflows() const { return over; }
+
+private:
+    enum State : uint8_t { SYNC0, SYNC1, TYPE, SEQ, LENGTH, PAYLOAD, CRC_LO, CRC_HI };
+
+    void payload(uint8_t b);
+    uint8_t finish();
+
+    SetpointRing& ring;
+
+    State state = SYNC0;
+    uint8_t type = 0;
+    uint8_t seq = 0;
+    uint8_t length = 0;
+    uint8_t index = 0;
+    uint16_t crc = 0;
+    uint16_t received = 0;
+
+    uint8_t flags = 0;
+    uint8_t count = 0;
+    bool staging = false;   // the setpoints fit the ring and are being written
+
+    uint8_t expected = 0;
+    bool resetting = false;
+    uint16_t errors = 0;
+    uint16_t over = 0;
+};
+
+} // namespace firmware
@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+// written by 5bar_ik_tables from ARM_GEOMETRY in code/src/config.h, do not edit
+
+namespace firmware
+{
+
+// motors and links in 1/16 board units
+const int32_t IK_AX = 4080;
+const int32_t IK_AY = 3200;
+const int32_t IK_EX = 5520;
+const int32_t IK_EY = 3200;
+const int32_t IK_L1 = 2560;
+const int32_t IK_L4 = 2560;
+
+// proximal squared less distal squared, and the reach of each arm
+// squared, 1/256 units
+const int32_t IK_K1 = 0;
+const int32_t IK_K2 = 0;
+const uint32_t IK_NEAR1 = 0;
+const uint32_t IK_FAR1 = 26214400;
+const uint32_t IK_NEAR2 = 0;
+const uint32_t IK_FAR2 = 26214400;
+
+// atan(2^-i), 2^32 a turn
+const uint8_t IK_ITERATIONS = 24;
+const uint32_t IK_ATAN[IK_ITERATIONS] = {
+    536870912u, 316933406u, 167458907u, 85004756u,
+    42667331u, 21354465u, 10679838u, 5340245u,
+    2670163u, 1335087u, 667544u, 333772u,
+    166886u, 83443u, 41722u, 20861u,
+    10430u, 5215u, 2608u, 1304u,
+    652u, 326u, 163u, 81u,
+};
+
+} // namespace firmware
@@ -0,0 +1,75 @@
+#include "interpolator.h"
+
+namespace firmware
+{
+
+int32_t Microsteps(int32_t counts)
+{
+    if (counts >= 0) return (counts * STEPS_NUM + STEPS_DEN / 2) / STEPS_DEN;
+
+    return -((-counts * STEPS_NUM + STEPS_DEN / 2) / STEPS_DEN);
+}
+
+void Interpolator::reset(int16_t theta1, int16_t theta2)
+{
+    last[0] = theta1;
+    last[1] = theta2;
+    counts[0] = theta1;
+    counts[1] = theta2;
+    steps[0] = Microsteps(theta1);
+    steps[1] = Microsteps(theta2);
+}
+
+void Interpolator::plan(const Setpoint& sp, StepSegment& out)
+{
+    int16_t wire[2] = {sp.theta1, sp.theta2};
+
+    out.dir = 0;
+    out.flags = sp.flags;
+    out.major = 0;
+
+    for (int j = 0; j < 2; j++)
+    {
+        int32_t delta = (int32_t)wire[j] - last[j];
+        if (delta >= ENCODER_COUNTS / 2) delta -= ENCODER_COUNTS;
+        if (delta < -ENCODER_COUNTS / 2) delta += ENCODER_COUNTS;
+
+        last[j] = wire[j];
+        counts[j] += delta;
+
+        int32_t move = Microsteps(counts[j]) - steps[j];
+        if (move > MAX_PERIOD_STEPS) move = MAX_PERIOD_STEPS;
+        if (move < -(int32_t)MAX_PERIOD_STEPS) move = -(int32_t)MAX_PERIOD_STEPS;
+
+        steps[j] += move;
+
+        if (move > 0) out.dir |= 1 << j;
+        out.count[j] = (uint16_t)(move < 0 ? -move : move);
+        if (out.count[j] > out.major) out.major = out.count[j];
+
+        FW_OPS(24);
+    }
+
+    FW_OPS(6);
+
+    if (!out.major) return;
+
+    // step i at (2i + 1) PERIOD_TICKS / (2 major): the first quotient and
+    // remainder, then 2 PERIOD_TICKS more numerator each step
+    uint16_t modulus = 2 * out.major;
+
+    out.first = PERIOD_TICKS / modulus;
+    out.remainder = PERIOD_TICKS % modulus;
+    out.interval = PERIOD_TICKS / out.major;
+    out.carry = 2 * (PERIOD_TICKS % out.major);
+    out.modulus = modulus;
+
+    FW_OPS(2 * DIVIDE_OPS + 8);
+}
+
+void Interpolator::unplan(const StepSegment& s)
+{
+    for (int j = 0; j < 2; j++) steps[j] += (s.dir & (1 << j)) ? -(int32_t)s.count[j] : (int32_t)s.count[j];
+}
+
+} // namespace firmware
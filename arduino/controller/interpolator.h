@@ -0,0 +1,37 @@
+#pragma once
+#include "firmware.h"
+
+namespace firmware
+{
+
+// turns setpoints into step segments, in loop(). the wire's counts wrap
+// at half a turn, a joint never turns that far in a period, so each
+// setpoint is taken the short way from the last and the joints are
+// tracked unwrapped. targets are rounded to a whole microstep and the
+// steps planned are counted against them, so position never drifts
+class Interpolator
+{
+public:
+    // the joints are at these counts, as after homing
+    void reset(int16_t theta1, int16_t theta2);
+
+    // the segment that takes the joints to sp over one control period
+    void plan(const Setpoint& sp, StepSegment& out);
+
+    // a planned segment that will not be played, its steps are taken back
+    // so the next setpoint is planned from where the joints really stop
+    void unplan(const StepSegment& s);
+
+    // microsteps from zero once the segments planned so far are played
+    int32_t position(int joint) const { return steps[joint]; }
+
+private:
+    int16_t last[2] = {};
+    int32_t counts[2] = {};
+    int32_t steps[2] = {};
+};
+
+// counts to microsteps, halves away from zero as llround does on the host
+int32_t Microsteps(int32_t counts);
+
+} // namespace firmware
@@ -0,0 +1,88 @@
+#pragma once
+#include "firmware.h"
+
+namespace firmware
+{
+
+// setpoints taken off the wire and not yet planned. loop() both fills and
+// drains it, so nothing here is shared with the interrupt. a frame's
+// setpoints are written past the head as its bytes arrive and published
+// together once its crc checks, so no frame is ever buffered whole
+class SetpointRing
+{
+public:
+    uint16_t size() const { return (uint16_t)(head - tail); }
+    uint16_t space() const { return QUEUE_SETPOINTS - size(); }
+
+    Setpoint& staged(uint16_t k) { return slots[(uint16_t)(head + k) & (QUEUE_SETPOINTS - 1)]; }
+    void publish(uint16_t n) { head += n; }
+
+    bool pop(Setpoint& out)
+    {
+        if (head == tail) return false;
+
+        out = slots[tail & (QUEUE_SETPOINTS - 1)];
+        tail++;
+
+        return true;
+    }
+
+    void clear() { tail = head; }
+
+private:
+    Setpoint slots[QUEUE_SETPOINTS];
+    uint16_t head = 0;   // free running, masked on use
+    uint16_t tail = 0;
+};
+
+// planned step segments handed from loop() to the step interrupt. one
+// byte indices, so each side's update is a single store, fenced from the
+// slot it hands over
+class SegmentQueue
+{
+public:
+    uint8_t size() const { return (uint8_t)(head - tail); }
+    bool full() const { return size() == QUEUE_SEGMENTS; }
+
+    // loop() side
+    void push(const StepSegment& s)
+    {
+        slots[head & (QUEUE_SEGMENTS - 1)] = s;
+        FW_BARRIER();
+        head = (uint8_t)(head + 1);
+    }
+
+    // interrupt side, the segment stays put until drop()
+    const StepSegment* front() const
+    {
+        bool empty = head == tail;
+        FW_BARRIER();
+
+        return empty ? 0 : &slots[tail & (QUEUE_SEGMENTS - 1)];
+    }
+
+    void drop()
+    {
+        FW_BARRIER();
+        tail = (uint8_t)(tail + 1);
+    }
+
+    // loop() side with the interrupt held off, takes back the segment
+    // pushed last unless only the first n are left
+    bool unpush(uint8_t n, StepSegment& s)
+    {
+        if (size() <= n) return false;
+
+        head = (uint8_t)(head - 1);
+        s = slots[head & (QUEUE_SEGMENTS - 1)];
+
+        return true;
+    }
+
+private:
+    StepSegment slots[QUEUE_SEGMENTS];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+};
+
+} // namespace firmware
@@ -0,0 +1,107 @@
+#include "step_isr.h"
+
+namespace firmware
+{
+
+#ifdef FIRMWARE_COUNT_OPS
+uint32_t countedOps = 0;
+uint8_t countedPath = 0;
+#endif
+
+uint16_t StepGenerator::tick()
+{
+    uint16_t delay;
+
+    FW_OPS(2);
+
+    if (ending)
+    {
+        // a period starts now, the last one's segment goes back to loop()
+        // and the next is played where it sits, or the joints hold still
+        if (current) queue.drop();
+
+        current = queue.front();
+        FW_OPS(7);
+
+        if (!current)
+        {
+            if (owed) dry++;
+
+            pulse = 0;
+            FW_OPS(5);
+            FW_PATH(PATH_IDLE);
+            return PERIOD_TICKS;
+        }
+
+        owed = !(current->flags & SETPOINT_END);
+        dir = current->dir;
+        FW_OPS(6);
+
+        if (!current->major)
+        {
+            pulse = 0;
+            FW_OPS(3);
+            FW_PATH(PATH_IDLE);
+            return PERIOD_TICKS;
+        }
+
+        planned = 0;
+        error[0] = error[1] = current->major / 2;
+        remainder = current->remainder;
+        elapsed = 0;
+        ending = false;
+        delay = current->first;
+        FW_OPS(10);
+        FW_PATH(PATH_PERIOD);
+    }
+    else if (planned < current->major)
+    {
+        delay = current->interval;
+        remainder += current->carry;
+        FW_OPS(7);
+        FW_PATH(PATH_STEP);
+
+        if (remainder >= current->modulus)
+        {
+            remainder -= current->modulus;
+            delay++;
+            FW_OPS(4);
+            FW_PATH(PATH_CARRY);
+        }
+    }
+    else
+    {
+        // the last step was this fire, the next ends the period
+        ending = true;
+        pulse = 0;
+        FW_OPS(6);
+        FW_PATH(PATH_END);
+        return PERIOD_TICKS - elapsed;
+    }
+
+    // which joints step on the fire planned, bresenham
+    uint8_t bits = 0;
+
+    error[0] += current->count[0];
+    if (error[0] >= current->major)
+    {
+        error[0] -= current->major;
+        bits |= 1;
+    }
+
+    error[1] += current->count[1];
+    if (error[1] >= current->major)
+    {
+        error[1] -= current->major;
+        bits |= 2;
+    }
+
+    pulse = bits;
+    planned++;
+    elapsed += delay;
+    FW_OPS(22);
+
+    return delay;
+}
+
+} // namespace firmware
@@ -0,0 +1,61 @@
+#pragma once
+#include "firmware.h"
+#include "queues.h"
+
+namespace firmware
+{
+
+// paths through StepGenerator::tick, for the op counts
+enum StepPath : uint8_t
+{
+    PATH_PERIOD = 0,   // a period starts, its first step is planned
+    PATH_IDLE,         // a period starts with no steps, or none queued
+    PATH_STEP,         // the next step, no time carry
+    PATH_CARRY,        // the next step, the time remainder carries
+    PATH_END,          // the last step is out, wait for the period's end
+    STEP_PATHS
+};
+
+// the step interrupt. the timer fires at every step and at every period's
+// end, and each fire plans the next: tick() returns the timer ticks to it
+// and steps() the step lines to raise when it comes, so the lines go up
+// on the compare match with no jitter and stay up while tick() runs, the
+// pulse width the drivers need. direction() is only ever changed by the
+// fire that starts a period, a slice before its first step
+class StepGenerator
+{
+public:
+    explicit StepGenerator(SegmentQueue& queue) : queue(queue) {}
+
+    uint16_t tick();
+
+    // takes back the last segment queued behind the one playing, false
+    // once there is none. from loop() with the interrupt held off
+    bool unqueue(StepSegment& s) { return queue.unpush(current ? 1 : 0, s); }
+
+    uint8_t steps() const { return pulse; }
+    uint8_t direction() const { return dir; }
+
+    // periods the queue was empty with a trajectory still playing, wraps
+    uint16_t underruns() const { return dry; }
+
+    // the segment being played has not ended its trajectory
+    bool playing() const { return owed; }
+
+private:
+    SegmentQueue& queue;
+
+    const StepSegment* current = 0;   // in the queue until its period ends
+    uint16_t planned = 0;   // steps of current whose fire has been planned
+    uint16_t error[2] = {};
+    uint16_t remainder = 0;
+    uint16_t elapsed = 0;   // ticks into the period of the fire planned
+    bool ending = true;     // the fire planned ends the period
+
+    uint8_t pulse = 0;
+    uint8_t dir = 0;
+    bool owed = false;
+    uint16_t dry = 0;
+};
+
+} // namespace firmware
@@ -0,0 +1,282 @@
+// firmware interrupt budget, on the host
+//
+//   firmware_bench [--seconds s] [--rate r] [--mhz f] [--cycles-per-op c] [--overhead c]
+//
+// runs the controller core in arduino/controller the way the board does:
+// setpoint frames from the host's encoder go through its receiver into
+// the ring, loop() plans them into step segments and the step interrupt
+// is called at every compare match it asks for. both joints sweep a sine
+// whose peak is --rate steps a second, theta1 across the half turn where
+// the wire's counts wrap. the default is the most a period plays, so the
+// busiest periods hit MAX_PERIOD_STEPS and its closest fires. a faster
+// sweep is clamped and catches up after, as the board does. every step
+// must come out at the tick, and with the direction, that the host's
+// StepTimeline gives the clamped targets, and every credit has to decode
+// on the host as the frame just taken.
+//
+// the core counts its primitive operations on each path of the interrupt
+// and the interpolator. at --cycles-per-op (2) on a --mhz (16) core, plus
+// --overhead cycles (60) a fire for the vector, register saves and port
+// writes, the worst fire has to finish before the closest fire after it,
+// and the report gives the busiest control period's interrupt load. exits
+// non-zero if a step differs or the worst fire does not fit
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "config.h"
+#include "kinematics.h"
+#include "protocol.h"
+#include "steps.h"
+#include "frames.h"
+#include "interpolator.h"
+#include "queues.h"
+#include "step_isr.h"
+
+static_assert(firmware::FRAME_SYNC0 == FRAME_SYNC0 && firmware::FRAME_SYNC1 == FRAME_SYNC1, "sync");
+static_assert(firmware::FRAME_OVERHEAD == FRAME_OVERHEAD, "overhead");
+static_assert(firmware::FRAME_RESET == FRAME_RESET && firmware::FRAME_SETPOINTS == FRAME_SETPOINTS, "types");
+static_assert(firmware::FRAME_CREDIT == FRAME_CREDIT && firmware::FRAME_NAK == FRAME_NAK, "types");
+static_assert(firmware::BATCH_SETPOINTS == BATCH_SETPOINTS && firmware::SETPOINTS_END == SETPOINTS_END, "batches");
+static_assert(firmware::ENCODER_COUNTS == ENCODER_COUNTS, "encoder");
+
+struct Fire
+{
+    uint64_t at;
+    uint8_t step;
+    uint8_t dir;
+
+    bool operator==(const Fire& o) const { return at == o.at && step == o.step && dir == o.dir; }
+};
+
+struct PathStats
+{
+    uint64_t fires = 0;
+    uint32_t worst = 0;
+    double total = 0;
+};
+
+static const char* PATH_NAMES[firmware::STEP_PATHS] = {"period start", "idle period", "step", "step, carry", "period end"};
+
+int main(int argc, char** argv)
+{
+    double seconds = 10;
+    double rate = (double)firmware::MAX_PERIOD_STEPS * firmware::CONTROL_HZ;
+    double mhz = 16;
+    double cyclesPerOp = 2;
+    double overhead = 60;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::max(0.01, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = std::max(1.0, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--mhz") && i + 1 < argc) mhz = std::max(1.0, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--cycles-per-op") && i + 1 < argc) cyclesPerOp = std::max(0.1, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--overhead") && i + 1 < argc) overhead = std::max(0.0, atof(argv[++i]));
+    }
+
+    const double perRadian = STEPPERS.stepsPerRadian();
+    const double period = (double)firmware::PERIOD_TICKS;
+
+    if (STEPPERS.clockHz != firmware::TIMER_HZ || CONTROL_HZ != firmware::CONTROL_HZ ||
+        std::lround(STEPPERS.stepsPerTurn * STEPPERS.microsteps * STEPPERS.gear) != firmware::MICROSTEPS)
+    {
+        fprintf(stderr, "arduino/controller/firmware.h does not match STEPPERS and CONTROL_HZ in config.h\n");
+        return 1;
+    }
+
+    // the sweep, as counts unwrapped and on the wire
+    const double frequency = 3.0;
+    const double amplitude = rate / perRadian / (6.283185307179586 * frequency);
+    size_t n = (size_t)(seconds * CONTROL_HZ) + 1;
+
+    std::vector<int32_t> counts[2];
+    std::vector<WireSetpoint> wire(n);
+
+    for (size_t k = 0; k < n; k++)
+    {
+        double t = k / CONTROL_HZ;
+        double theta[2] = {2.6 + amplitude * std::sin(6.283185307179586 * frequency * t),
+                           -1.0 + amplitude * std::sin(6.283185307179586 * frequency * t + 1.0)};
+
+        for (int j = 0; j < 2; j++) counts[j].push_back((int32_t)std::lround(theta[j] * ENCODER_COUNTS / 6.283185307179586));
+
+        wire[k] = {EncoderCounts(theta[0]), EncoderCounts(theta[1])};
+    }
+
+    // what the host's step timeline makes of the same microstep targets,
+    // each period moving no more than the firmware's clamp lets it
+    Trajectory reference;
+    reference.dt = 1.0 / CONTROL_HZ;
+    reference.setpoints.resize(n);
+
+    const int64_t clamp = firmware::MAX_PERIOD_STEPS;
+    int64_t walk[2] = {std::llround(counts[0][0] * 25.0 / 32.0), std::llround(counts[1][0] * 25.0 / 32.0)};
+
+    for (size_t k = 0; k < n; k++)
+    {
+        for (int j = 0; j < 2; j++) walk[j] += std::clamp((int64_t)std::llround(counts[j][k] * 25.0 / 32.0) - walk[j], -clamp, clamp);
+
+        reference.setpoints[k].theta1 = (float)(walk[0] / perRadian);
+        reference.setpoints[k].theta2 = (float)(walk[1] / perRadian);
+    }
+
+    StepTimeline timeline(STEPPERS);
+    std::vector<StepEvent> events;
+    timeline.reset(reference.setpoints[0].theta1, reference.setpoints[0].theta2);
+    timeline.append(reference, events);
+
+    std::vector<Fire> expected;
+    uint64_t clock = 0;
+
+    for (const StepEvent& e : events)
+    {
+        clock += e.delay;
+        if (e.step) expected.push_back({clock, e.step, e.dir});
+    }
+
+    // the frames the host would send, a reset then the sweep after its first pose
+    std::vector<std::vector<uint8_t>> frames;
+    uint8_t frame[FRAME_OVERHEAD + FRAME_PAYLOAD_MAX];
+
+    frames.emplace_back(frame, frame + EncodeFrame(FRAME_RESET, 0, nullptr, 0, frame));
+
+    for (size_t k = 1, seq = 1; k < n; k += BATCH_SETPOINTS, seq++)
+    {
+        int count = (int)std::min(n - k, (size_t)BATCH_SETPOINTS);
+        uint8_t flags = k + count == n ? SETPOINTS_END : 0;
+        frames.emplace_back(frame, frame + EncodeSetpoints((uint8_t)seq, flags, &wire[k], count, frame));
+    }
+
+    // the board
+    static firmware::SetpointRing ring;
+    firmware::SegmentQueue segments;
+    firmware::FrameReceiver receiver(ring);
+    firmware::Interpolator interpolator;
+    firmware::StepGenerator generator(segments);
+
+    interpolator.reset(wire[0].theta1, wire[0].theta2);
+
+    std::vector<Fire> fired;
+    PathStats paths[firmware::STEP_PATHS];
+    std::vector<double> load((size_t)(n + 2));
+    uint32_t worstOps = 0, worstPlan = 0;
+    int worstPath = 0;
+    uint64_t plans = 0;
+    double planOps = 0;
+    uint16_t shortest = UINT16_MAX;
+    uint64_t now = 0;
+    uint8_t pending = 0;
+    size_t sent = 0;
+    int credits = 0;
+    bool acked = true;
+    FrameParser host;
+
+    while (now < (n + 1) * (uint64_t)firmware::PERIOD_TICKS)
+    {
+        // the host sends while the credits allow
+        while (sent < frames.size() && (sent == 0 || ring.space() >= BATCH_SETPOINTS))
+        {
+            for (uint8_t b : frames[sent])
+            {
+                if (receiver.feed(b) != firmware::REPLY_CREDIT) continue;
+
+                // the credit has to read back on the host as this frame taken
+                uint8_t reply[firmware::REPLY_MAX];
+                uint8_t size = receiver.credit((uint16_t)(ring.size() + segments.size()), generator.underruns(), reply);
+                CreditReport r = {};
+                bool got = false;
+
+                for (uint8_t k = 0; k < size; k++) got = host.feed(reply[k]) && DecodeCredit(host.frame(), r);
+
+                acked = acked && got && r.ack == frames[sent][3] && r.free == ring.space();
+                credits++;
+            }
+
+            if (receiver.takeReset())
+            {
+                firmware::StepSegment dropped;
+                while (generator.unqueue(dropped)) interpolator.unplan(dropped);
+            }
+
+            sent++;
+        }
+
+        // loop()
+        firmware::Setpoint sp;
+
+        while (!segments.full() && ring.pop(sp))
+        {
+            firmware::StepSegment s;
+            firmware::countedOps = 0;
+            interpolator.plan(sp, s);
+            segments.push(s);
+
+            plans++;
+            planOps += firmware::countedOps;
+            worstPlan = std::max(worstPlan, firmware::countedOps);
+        }
+
+        // the compare match
+        if (pending) fired.push_back({now, pending, generator.direction()});
+
+        firmware::countedOps = 0;
+        uint16_t delay = generator.tick();
+        pending = generator.steps();
+
+        PathStats& p = paths[firmware::countedPath];
+        p.fires++;
+        p.total += firmware::countedOps;
+        p.worst = std::max(p.worst, firmware::countedOps);
+
+        if (firmware::countedOps > worstOps)
+        {
+            worstOps = firmware::countedOps;
+            worstPath = firmware::countedPath;
+        }
+
+        load[std::min(load.size() - 1, (size_t)(now / firmware::PERIOD_TICKS))] += firmware::countedOps * cyclesPerOp + overhead;
+        shortest = std::min(shortest, delay);
+        now += delay;
+    }
+
+    bool match = fired == expected;
+    bool placed = interpolator.position(0) == walk[0] && interpolator.position(1) == walk[1];
+
+    // one timer tick is this many core cycles
+    double cyclesPerTick = mhz * 1e6 / firmware::TIMER_HZ;
+    double worstCycles = worstOps * cyclesPerOp + overhead;
+    double gapCycles = shortest * cyclesPerTick;
+    double busiest = *std::max_element(load.begin(), load.end());
+    double periodCycles = period * cyclesPerTick;
+    const StepStats& s = timeline.stats();
+
+    printf("%.0f s at up to %.0f steps/s: %llu + %llu steps, peak %.0f / %.0f a second, %zu frames, %d credits, %u underruns\n",
+           seconds, rate, (unsigned long long)s.steps[0], (unsigned long long)s.steps[1], s.peakRate[0], s.peakRate[1],
+           frames.size(), credits, generator.underruns());
+
+    for (int k = 0; k < firmware::STEP_PATHS; k++)
+    {
+        const PathStats& p = paths[k];
+        if (p.fires) printf("  %-13s %9llu fires, %5.1f ops mean, %3u worst\n", PATH_NAMES[k], (unsigned long long)p.fires,
+                            p.total / p.fires, p.worst);
+    }
+
+    printf("worst fire: %u ops (%s), %.0f cycles = %.2f us against %.0f cycles to the closest next fire (%u ticks)\n",
+           worstOps, PATH_NAMES[worstPath], worstCycles, worstCycles / mhz, gapCycles, shortest);
+    printf("busiest period: %.0f of %.0f cycles in the interrupt (%.1f%%), planning a segment %.0f ops mean, %u worst (%.1f%%)\n",
+           busiest, periodCycles, 100 * busiest / periodCycles, plans ? planOps / plans : 0.0, worstPlan,
+           100 * worstPlan * cyclesPerOp / periodCycles);
+    printf("steps %s the host's timeline (%zu of %zu), joints %s\n", match ? "match" : "DO NOT MATCH", fired.size(),
+           expected.size(), placed ? "on the last setpoint" : "OFF the last setpoint");
+
+    bool fits = worstCycles < gapCycles;
+    if (!fits) fprintf(stderr, "the worst fire does not finish before the next one\n");
+
+    if (!acked) fprintf(stderr, "a credit did not read back on the host\n");
+
+    return match && placed && fits && acked ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// fixed point inverse kinematics against the double reference
+//
+//   fixed_ik_bench [--step s] [--cycles-per-op c] [--mhz f]
+//
+// sweeps the arm's whole bounding box every --step board units (1/4 by
+// default, a multiple of the controller's 1/16) through the controller's
+// SolveIKFixed and through SolveIKPrecise rounded to encoder counts.
+// reports where the two disagree on reach, the count differences, and how
+// far forward kinematics puts the end effector from the target for both,
+// over the whole workspace, the board alone and the poses whose jacobian
+// condition is under WELL_POSED, where a count is worth a fraction of a
+// unit rather than whole ones. with the primitive
+// operations a solve takes and what that is of a control period at
+// --cycles-per-op (2) on a --mhz (16) core. exits non-zero if an angle is
+// more than a count out further than REACH_BAND from the edge of reach,
+// where the arm is straight and a count is worth whole units, if reach
+// differs away from that edge, or if ik_tables.h is not what
+// 5bar_ik_tables writes for config.h
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "config.h"
+#include "kinematics.h"
+#include "plan.h"
+#include "fixed_ik.h"
+#include "ik_tables.h"
+
+const float WELL_POSED = 20.0f;
+const double REACH_BAND = 1.0 / 64;
+
+struct Errors
+{
+    uint64_t points = 0;
+    uint64_t off[3] = {};   // solves with the worst joint 0, 1 and over 1 count out
+    uint64_t offEdge = 0;   // of the last, those within REACH_BAND of the edge
+    double fixedWorst = 0;  // end effector from the target, board units
+    double roundedWorst = 0;
+    double fixedTotal = 0;
+};
+
+static int CountsApart(int a, int b)
+{
+    int d = (a - b) % ENCODER_COUNTS;
+    if (d > ENCODER_COUNTS / 2) d -= ENCODER_COUNTS;
+    if (d < -ENCODER_COUNTS / 2) d += ENCODER_COUNTS;
+
+    return std::abs(d);
+}
+
+// how far (x, y) is from where either arm comes straight
+static double ReachEdge(const FiveBar& g, double x, double y)
+{
+    double d = std::hypot(x - g.ax, y - g.ay), e = std::hypot(x - g.ex, y - g.ey);
+
+    return std::min({std::fabs(d - (g.l1 + g.l2)), std::fabs(d - std::fabs(g.l1 - g.l2)), std::fabs(e - (g.l4 + g.l3)),
+                     std::fabs(e - std::fabs(g.l4 - g.l3))});
+}
+
+static bool TablesCurrent(const FiveBar& g)
+{
+    auto Fixed = [](float v) { return (int32_t)std::lround(v * firmware::POSITION_SCALE); };
+
+    bool ok = firmware::IK_AX == Fixed(g.ax) && firmware::IK_AY == Fixed(g.ay) && firmware::IK_EX == Fixed(g.ex) &&
+              firmware::IK_EY == Fixed(g.ey) && firmware::IK_L1 == Fixed(g.l1) && firmware::IK_L4 == Fixed(g.l4) &&
+              firmware::IK_FAR1 == (uint32_t)((Fixed(g.l1) + Fixed(g.l2)) * (Fixed(g.l1) + Fixed(g.l2))) &&
+              firmware::IK_FAR2 == (uint32_t)((Fixed(g.l4) + Fixed(g.l3)) * (Fixed(g.l4) + Fixed(g.l3)));
+
+    for (int i = 0; i < firmware::IK_ITERATIONS; i++)
+        ok = ok && firmware::IK_ATAN[i] == (uint32_t)std::llround(std::ldexp(std::atan(std::ldexp(1.0, -i)) / 6.283185307179586, 32));
+
+    return ok;
+}
+
+static void Report(const char* name, const Errors& e)
+{
+    double n = std::max<uint64_t>(e.points, 1);
+
+    printf("%-10s %9llu points: worst joint exact %.3f%%, 1 count %.3f%%, more %llu (%llu at the edge); end effector %.4f mean, %.4f worst, "
+           "%.4f worst from the reference's own counts\n",
+           name, (unsigned long long)e.points, 100 * e.off[0] / n, 100 * e.off[1] / n, (unsigned long long)e.off[2],
+           (unsigned long long)e.offEdge,
+           e.fixedTotal / n, e.fixedWorst, e.roundedWorst);
+}
+
+int main(int argc, char** argv)
+{
+    double step = 0.25;
+    double cyclesPerOp = 2;
+    double mhz = 16;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--step") && i + 1 < argc) step = std::max(1.0 / firmware::POSITION_SCALE, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--cycles-per-op") && i + 1 < argc) cyclesPerOp = std::max(0.1, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--mhz") && i + 1 < argc) mhz = std::max(1.0, atof(argv[++i]));
+    }
+
+    const FiveBar& g = ARM_GEOMETRY;
+
+    if (!TablesCurrent(g))
+    {
+        fprintf(stderr, "arduino/controller/ik_tables.h is stale, regenerate it with 5bar_ik_tables\n");
+        return 1;
+    }
+
+    // the board, corner to corner of its squares
+    Vector2 lo = CellCenter({0, 0}), hi = CellCenter({7, 7});
+    float half = squareSize / 2.0f;
+
+    double reach = std::max(g.l1 + g.l2, g.l4 + g.l3);
+    double x0 = std::min(g.ax, g.ex) - reach, x1 = std::max(g.ax, g.ex) + reach;
+    double y0 = std::min(g.ay, g.ey) - reach, y1 = std::max(g.ay, g.ey) + reach;
+    int stride = std::max(1, (int)std::lround(step * firmware::POSITION_SCALE));
+
+    Errors all, board, posed;
+    uint64_t reachDiffers = 0, reachEdge = 0, solves = 0;
+    uint32_t worstOps = 0;
+    double ops = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int32_t fy = (int32_t)(y0 * firmware::POSITION_SCALE); fy <= y1 * firmware::POSITION_SCALE; fy += stride)
+    {
+        for (int32_t fx = (int32_t)(x0 * firmware::POSITION_SCALE); fx <= x1 * firmware::POSITION_SCALE; fx += stride)
+        {
+            double x = fx / (double)firmware::POSITION_SCALE, y = fy / (double)firmware::POSITION_SCALE;
+
+            double t1, t2;
+            bool reference = SolveIKPrecise(g, x, y, t1, t2);
+
+            int16_t f1, f2;
+            firmware::countedOps = 0;
+            bool fixed = firmware::SolveIKFixed(fx, fy, f1, f2);
+
+            if (fixed)
+            {
+                solves++;
+                ops += firmware::countedOps;
+                worstOps = std::max(worstOps, firmware::countedOps);
+            }
+
+            if (reference != fixed)
+            {
+                // the integer reach test is exact on the 1/16 grid, the
+                // double one can land either side of it
+                if (ReachEdge(g, x, y) <= 1.0 / firmware::POSITION_SCALE) reachEdge++;
+                else reachDiffers++;
+                continue;
+            }
+
+            if (!reference) continue;
+
+            int16_t r1 = EncoderCounts(t1), r2 = EncoderCounts(t2);
+            int worst = std::max(CountsApart(f1, r1), CountsApart(f2, r2));
+            bool edge = worst > 1 && ReachEdge(g, x, y) <= REACH_BAND;
+
+            // where each set of counts actually puts the end effector
+            float fxC = (float)x, fyC = (float)y, rxC = (float)x, ryC = (float)y;
+            bool placed = SolveFK(g, (float)EncoderAngle(f1), (float)EncoderAngle(f2), fxC, fyC) &&
+                          SolveFK(g, (float)EncoderAngle(r1), (float)EncoderAngle(r2), rxC, ryC);
+
+            double fixedError = placed ? std::hypot(fxC - x, fyC - y) : 0;
+            double roundedError = placed ? std::hypot(rxC - x, ryC - y) : 0;
+
+            bool onBoard = x >= lo.x - half && x <= hi.x + half && y >= lo.y - half && y <= hi.y + half;
+            bool wellPosed = SolveJacobian(g, (float)t1, (float)t2, (float)x, (float)y).condition < WELL_POSED;
+
+            for (Errors* e : {&all, onBoard ? &board : nullptr, wellPosed ? &posed : nullptr})
+            {
+                if (!e) continue;
+
+                e->points++;
+                e->off[std::min(worst, 2)]++;
+                e->offEdge += edge;
+                e->fixedWorst = std::max(e->fixedWorst, fixedError);
+                e->roundedWorst = std::max(e->roundedWorst, roundedError);
+                e->fixedTotal += fixedError;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double periodCycles = mhz * 1e6 / CONTROL_HZ;
+
+    Report("workspace", all);
+    Report("board", board);
+    Report("well posed", posed);
+    printf("reach: %llu points differ within 1/%d unit of its edge, %llu elsewhere\n", (unsigned long long)reachEdge,
+           firmware::POSITION_SCALE, (unsigned long long)reachDiffers);
+    printf("ops a solve: %.0f mean, %u worst, %.0f cycles = %.0f us, %.1f%% of a control period; swept in %.2f s\n",
+           solves ? ops / solves : 0.0, worstOps, worstOps * cyclesPerOp, worstOps * cyclesPerOp / mhz,
+           100 * worstOps * cyclesPerOp / periodCycles, seconds);
+
+    bool ok = all.off[2] == all.offEdge && reachDiffers == 0;
+    if (!ok) fprintf(stderr, "the fixed point solution is off past its bounds\n");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+// inverse kinematics throughput, point at a time against the batch kernel
+//
+//   ik_bench [--points n] [--rounds r]
+//
+// targets are spread over the arm's bounding box so a share of them are
+// out of reach. reports ns per point for both and the worst angle
+// difference between them, exiting non-zero if the batch result drifts
+// past 1e-4 rad or disagrees on reachability.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "kinematics.h"
+
+const FiveBar geometry = ARM_GEOMETRY;
+
+template <typename F>
+double Time(int rounds, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) f();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int n = 4096;
+    int rounds = 2000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--points") && i + 1 < argc) n = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::max(1, atoi(argv[++i]));
+    }
+
+    std::vector<float> x(n), y(n), t1(n), t2(n);
+    std::vector<uint8_t> valid(n);
+    std::vector<IKSolution> single(n);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> px(geometry.ax - 340, geometry.ex + 340);
+    std::uniform_real_distribution<float> py(geometry.ay - 100, geometry.ay + 340);
+
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = px(rng);
+        y[i] = py(rng);
+    }
+
+    double ts = Time(rounds, [&]
+    {
+        for (int i = 0; i < n; i++) single[i] = SolveIK(geometry, x[i], y[i]);
+    });
+
+    double tb = Time(rounds, [&]
+    {
+        SolveIKBatch(geometry, x.data(), y.data(), n, t1.data(), t2.data(), valid.data());
+    });
+
+    float worst = 0;
+    int reachable = 0, disagree = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (valid[i] != single[i].valid) disagree++;
+        if (!single[i].valid) continue;
+
+        reachable++;
+        worst = std::max(worst, std::fabs(t1[i] - single[i].theta1));
+        worst = std::max(worst, std::fabs(t2[i] - single[i].theta2));
+    }
+
+    double points = (double)n * rounds;
+
+    printf("%d points x %d rounds, %d reachable, batch path %s\n\n", n, rounds, reachable, IKBatchPath());
+    printf("  %-8s %10.2f ns/point\n", "single", ts / points * 1e9);
+    printf("  %-8s %10.2f ns/point  %.2fx\n\n", "batch", tb / points * 1e9, ts / tb);
+    printf("max angle error %.2e rad, %d reachability mismatches\n", worst, disagree);
+
+    return (worst > 1e-4f || disagree) ? 1 : 0;
+}
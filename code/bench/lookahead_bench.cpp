@@ -0,0 +1,98 @@
+// lookahead planner append cost
+//
+//   lookahead_bench [--segments n] [--rounds n]
+//
+// streams a path of short segments weaving across the board through the
+// lookahead planner, playing a tick whenever the ring is full, for streams
+// of n / 100, n / 10 and n segments (100000 by default). reports ns per
+// append and the blocks the passes visit per append, which stay flat as
+// the stream grows, and exits non-zero if the arm does not end on the
+// last point or a joint passes the velocity limit
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "config.h"
+#include "lookahead.h"
+
+int main(int argc, char** argv)
+{
+    int segments = 100000;
+    int rounds = 3;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--segments") && i + 1 < argc) segments = std::max(100, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::max(1, atoi(argv[++i]));
+    }
+
+    const double dt = 1.0 / CONTROL_HZ;
+
+    // 2 unit steps along a sine over the middle of the board, back and forth
+    std::vector<Vector2> path(segments + 1);
+
+    for (int k = 0; k <= segments; k++)
+    {
+        double u = std::fmod(k * 2.0, 600.0);
+        double x = u < 300 ? u : 600 - u;
+        path[k] = {(float)(110 + x), (float)(380 + 60 * std::sin(x / 25.0))};
+    }
+
+    bool ok = true;
+
+    for (int n : {segments / 100, segments / 10, segments})
+    {
+        double best = 1e30;
+        uint64_t visits = 0;
+        double seconds = 0;
+
+        for (int r = 0; r < rounds; r++)
+        {
+            LookaheadPlanner planner(ARM_GEOMETRY, MOTOR_LIMITS, path[0]);
+            JointSetpoint sp = {}, last = {};
+            uint64_t ticks = 0;
+            double appending = 0;
+            float peak = 0;
+
+            auto Tick = [&]
+            {
+                last = sp;
+                planner.next(dt, sp);
+                if (ticks++) peak = std::max({peak, std::fabs(sp.theta1 - last.theta1), std::fabs(sp.theta2 - last.theta2)});
+            };
+
+            for (int k = 1; k <= n; k++)
+            {
+                while (planner.full()) Tick();
+
+                auto start = std::chrono::steady_clock::now();
+                planner.append(path[k], k == n);
+                appending += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            while (planner.queued()) Tick();
+
+            best = std::min(best, appending);
+            visits = planner.replanned();
+            seconds = ticks * dt;
+
+            if (std::hypot(sp.x - path[n].x, sp.y - path[n].y) > 1e-3f || peak / dt > MOTOR_LIMITS.velocity * 1.01f)
+                ok = false;
+        }
+
+        printf("%7d segments: %6.1f ns an append, %5.1f blocks visited an append, %.1f s of motion\n",
+               n, best * 1e9 / n, (double)visits / n, seconds);
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "the arm left the path or passed the velocity limit\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+// move generator correctness and throughput on the standard perft suite
+//
+//   perft_bench [--threads n] [--hash mb] [--extra plies] [--min-mnps x]
+//
+// runs the suite at 1, 2, 4 .. n threads, splitting the tree two plies
+// below the root across a work stealing pool. exits non-zero on a node
+// count mismatch or when the single thread rate drops below --min-mnps,
+// so it can gate builds.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "movegen.h"
+#include "pool.h"
+
+struct PerftCase
+{
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t nodes[2];
+};
+
+const PerftCase cases[] =
+{
+    {"startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, {4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, {4085603, 193690690}},
+    {"endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, {674624, 11030083}},
+    {"promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, {422333, 15833292}},
+    {"talkchess", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, {2103487, 89941194}},
+    {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, {3894594, 164075551}},
+    // en passant that uncovers a rook along the rank, a bishop along the
+    // diagonal, and one that gives check itself
+    {"ep rank", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, {1134888, 20757544}},
+    {"ep diagonal", "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, {1015133, 14047573}},
+    {"ep check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, {1440467, 21190412}},
+};
+
+// shared perft hash, the key is stored xor'd with the count so torn
+// writes from racing threads fail verification instead of corrupting counts
+class PerftTable
+{
+public:
+    explicit PerftTable(size_t megabytes)
+    {
+        size_t n = 1;
+        while (n * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) n *= 2;
+
+        entries = std::vector<Entry>(megabytes ? n : 0);
+        mask = n - 1;
+    }
+
+    bool enabled() const { return !entries.empty(); }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const
+    {
+        const Entry& e = entries[key & mask];
+
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.check.load(std::memory_order_relaxed);
+
+        if ((check ^ data) != Mix(key, depth)) return false;
+
+        nodes = data;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes)
+    {
+        Entry& e = entries[key & mask];
+
+        e.data.store(nodes, std::memory_order_relaxed);
+        e.check.store(Mix(key, depth) ^ nodes, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+
+        Entry() = default;
+        Entry(const Entry&) {}
+    };
+
+    static uint64_t Mix(uint64_t key, int depth) { return key ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(depth + 1)); }
+
+    std::vector<Entry> entries;
+    size_t mask = 0;
+};
+
+uint64_t HashedPerft(Board& board, int depth, PerftTable& table)
+{
+    if (depth <= 1) return Perft(board, depth);
+
+    uint64_t nodes;
+    if (table.probe(board.key(), depth, nodes)) return nodes;
+
+    MoveList list;
+    GenerateLegal(board, list);
+
+    nodes = 0;
+
+    for (Move m : list)
+    {
+        Undo u;
+        board.make(m, u);
+        nodes += HashedPerft(board, depth - 1, table);
+        board.unmake(u);
+    }
+
+    table.store(board.key(), depth, nodes);
+
+    return nodes;
+}
+
+uint64_t ParallelPerft(const Board& root, int depth, TaskPool& pool, PerftTable& table)
+{
+    const int split = 2;
+
+    if (depth <= split) return Perft(const_cast<Board&>(root), depth);
+
+    std::atomic<uint64_t> total{0};
+
+    // every node two plies down becomes a task, roughly 400-2000 per position
+    MoveList first;
+    GenerateLegal(root, first);
+
+    for (Move a : first)
+    {
+        Board child = root;
+        Undo u;
+        child.make(a, u);
+
+        MoveList second;
+        GenerateLegal(child, second);
+
+        for (Move b : second)
+        {
+            Board leaf = child;
+            leaf.make(b, u);
+
+            pool.submit([leaf, depth, &table, &total]() mutable
+            {
+                uint64_t n = table.enabled() ? HashedPerft(leaf, depth - split, table) : Perft(leaf, depth - split);
+                total += n;
+            });
+        }
+    }
+
+    pool.wait();
+
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMb = 0;
+    int extra = 0;
+    double minMnps = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) maxThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hash") && i + 1 < argc) hashMb = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--extra") && i + 1 < argc) extra = std::clamp(atoi(argv[++i]), 0, 1);
+        else if (!strcmp(argv[i], "--min-mnps") && i + 1 < argc) minMnps = atof(argv[++i]);
+    }
+
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    int failures = 0;
+    double baseline = 0;
+
+    printf("hash %zu MB, extra plies %d\n\n", hashMb, extra);
+
+    for (int threads : counts)
+    {
+        TaskPool pool(threads);
+        uint64_t total = 0;
+        double seconds = 0;
+
+        printf("threads %d\n", threads);
+        printf("  %-12s %6s %12s %10s\n", "position", "depth", "nodes", "Mnps");
+
+        for (const PerftCase& c : cases)
+        {
+            // a fresh table per position keeps runs independent of order
+            PerftTable table(hashMb);
+            Board board;
+            board.setFen(c.fen);
+
+            int depth = c.depth + extra;
+
+            auto start = std::chrono::steady_clock::now();
+            uint64_t nodes = ParallelPerft(board, depth, pool, table);
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            bool ok = nodes == c.nodes[extra];
+            if (!ok) failures++;
+
+            printf("  %-12s %6d %12llu %10.2f %s\n", c.name, depth, (unsigned long long)nodes,
+                   nodes / s / 1e6, ok ? "" : "MISMATCH");
+
+            total += nodes;
+            seconds += s;
+        }
+
+        double mnps = total / seconds / 1e6;
+        if (threads == 1) baseline = mnps;
+
+        printf("  total %.2f Mnps, speedup %.2fx, steals %llu\n\n", mnps, mnps / baseline,
+               (unsigned long long)pool.steals());
+    }
+
+    if (minMnps > 0 && baseline < minMnps)
+    {
+        printf("single thread rate %.2f Mnps is below the %.2f Mnps floor\n", baseline, minMnps);
+        failures++;
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+// cost of building the engine position command versus game length
+//
+// plays a reversible knight shuffle (worst case for the incremental tail)
+// broken up by a pawn move every 40 plies, and times the legacy full
+// move list rebuild against PositionCommand at each checkpoint.
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "uci.h"
+
+using Clock = std::chrono::steady_clock;
+
+const char* shuffle[] = {"g1f3", "g8f6", "f3g1", "f6g8"};
+const char* pawns[] = {"a2a3", "h7h6", "a3a4", "h6h5", "b2b3", "g7g6", "b3b4", "g6g5",
+                       "c2c3", "f7f6", "c3c4", "f6f5", "d2d3", "e7e6", "d3d4", "e6e5"};
+
+std::string LegacyCommand(const std::vector<std::string>& moves)
+{
+    std::string cmd = "position startpos moves ";
+
+    for (const std::string& m : moves) cmd += m + " ";
+
+    return cmd;
+}
+
+template <typename F>
+double TimeNs(F&& f, int reps)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < reps; i++) f();
+
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / reps;
+}
+
+int main(void)
+{
+    const int checkpoints[] = {10, 50, 100, 200, 400, 800, 1600};
+    const int reps = 2000;
+
+    Board board;
+    PositionCommand position;
+    std::vector<std::string> moves;
+
+    int ply = 0;
+    int pawnIndex = 0;
+    int shuffleIndex = 0;
+    size_t sink = 0;
+
+    printf("%8s %14s %14s %10s %8s\n", "ply", "legacy ns", "incremental ns", "cmd bytes", "tail");
+
+    for (int target : checkpoints)
+    {
+        while (ply < target)
+        {
+            std::string uci;
+
+            // pawn moves come in white/black pairs to keep the knights in step
+            if (ply % 40 >= 38 && pawnIndex < 16) uci = pawns[pawnIndex++];
+            else uci = shuffle[shuffleIndex++ % 4];
+
+            bool irreversible = board.isIrreversible(uci);
+            board.applyUci(uci);
+
+            moves.push_back(uci);
+            position.push(board, uci, irreversible);
+            ply++;
+        }
+
+        double legacy = TimeNs([&] { sink += LegacyCommand(moves).size(); }, reps);
+        double incremental = TimeNs([&] { sink += position.build().size(); }, reps);
+
+        printf("%8d %14.0f %14.0f %10zu %8d\n", ply, legacy, incremental, position.build().size(), position.window());
+    }
+
+    return sink == 0;
+}
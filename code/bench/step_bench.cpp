@@ -0,0 +1,99 @@
+// step timeline throughput
+//
+//   step_bench [--seconds s] [--rate r] [--rounds n]
+//
+// both joints sweep a sine, out of phase, whose peak is --rate steps a
+// second (40000 by default) at the microstepping in config.h, as 1 khz
+// setpoints. reports generated steps per cpu second, ns per step and the
+// stream size, and exits non-zero if the steps taken do not add up to the
+// last setpoint or the event times do not add up to the timeline's length
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "config.h"
+#include "steps.h"
+
+int main(int argc, char** argv)
+{
+    double seconds = 60;
+    double rate = 40000;
+    int rounds = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::max(0.01, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = std::max(1.0, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::max(1, atoi(argv[++i]));
+    }
+
+    const double dt = 1.0 / CONTROL_HZ;
+    const double frequency = 3.0;
+    const double amplitude = rate / STEPPERS.stepsPerRadian() / (6.283185307179586 * frequency);
+
+    Trajectory traj;
+    traj.dt = dt;
+    traj.setpoints.resize((size_t)(seconds / dt) + 1);
+
+    for (size_t k = 0; k < traj.setpoints.size(); k++)
+    {
+        double t = k * dt;
+        JointSetpoint& sp = traj.setpoints[k];
+        sp.t = (float)t;
+        sp.theta1 = (float)(1.0 + amplitude * std::sin(6.283185307179586 * frequency * t));
+        sp.theta2 = (float)(-1.0 + amplitude * std::sin(6.283185307179586 * frequency * t + 1.0));
+    }
+
+    StepTimeline timeline(STEPPERS);
+    std::vector<StepEvent> events;
+
+    double best = 1e30;
+
+    for (int r = 0; r < rounds; r++)
+    {
+        // the vector keeps its capacity, later rounds allocate nothing
+        events.clear();
+        timeline.reset(traj.setpoints[0].theta1, traj.setpoints[0].theta2);
+
+        auto start = std::chrono::steady_clock::now();
+        timeline.append(traj, events);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const StepStats& s = timeline.stats();
+    uint64_t total = s.steps[0] + s.steps[1];
+
+    // replay the stream the way the step interrupt would
+    int64_t position[2] = {std::llround(traj.setpoints[0].theta1 * STEPPERS.stepsPerRadian()),
+                           std::llround(traj.setpoints[0].theta2 * STEPPERS.stepsPerRadian())};
+    uint64_t clock = 0;
+
+    for (const StepEvent& e : events)
+    {
+        clock += e.delay;
+        for (int j = 0; j < 2; j++)
+            if (e.step & (1 << j)) position[j] += (e.dir & (1 << j)) ? 1 : -1;
+    }
+
+    bool ok = position[0] == timeline.position(0) && position[1] == timeline.position(1) && clock <= timeline.ticks();
+
+    for (int j = 0; j < 2; j++)
+    {
+        const float theta = j ? traj.setpoints.back().theta2 : traj.setpoints.back().theta1;
+        ok = ok && timeline.position(j) == std::llround(theta * STEPPERS.stepsPerRadian());
+    }
+
+    printf("%.0f s of setpoints, %llu + %llu steps, peak %.0f / %.0f steps/s, %llu events (%llu waits), %.1f MB\n",
+           seconds, (unsigned long long)s.steps[0], (unsigned long long)s.steps[1], s.peakRate[0], s.peakRate[1],
+           (unsigned long long)s.events, (unsigned long long)s.waits, events.size() * sizeof(StepEvent) / 1e6);
+    printf("generated in %.2f ms: %.1f ns per step, %.0f M steps per cpu second, %.0fx real time\n", best * 1e3,
+           best * 1e9 / total, total / best / 1e6, seconds / best);
+    printf("replayed stream %s, last event at %.6f s of %.6f s\n", ok ? "matches" : "DOES NOT MATCH",
+           clock / (double)STEPPERS.clockHz, timeline.ticks() / (double)STEPPERS.clockHz);
+
+    return ok ? 0 : 1;
+}
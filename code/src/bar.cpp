@@ -1,30 +1,47 @@
 #include <raylib.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include "bar.h"
 #include "chess.h"
 #include "config.h"
+#include "kinematics.h"
+#include "link.h"
+#include "sim.h"
+#include "workspace.h"
 
 const float EP = 1e-6f;
 
-float L1 = 160;
-float L2 = 160;
-float L3 = L2;
-float L4 = L1;
-float L5 = 90;
+// the drawn arm starts as the one the planner and the tools solve for
+float L1 = ARM_GEOMETRY.l1;
+float L2 = ARM_GEOMETRY.l2;
+float L3 = ARM_GEOMETRY.l3;
+float L4 = ARM_GEOMETRY.l4;
+float L5 = ARM_GEOMETRY.ex - ARM_GEOMETRY.ax;
 
 float R1 = L1 + L2;
 float R2 = L3 + L4;
 
-Vector2 A = {(WIDTH - L5) / 2.0f, HEIGHT / 3.5f};
+Vector2 A = {ARM_GEOMETRY.ax, ARM_GEOMETRY.ay};
 Vector2 B = {A.x, A.y + L1};
-Vector2 C = {A.x + L5 / 2.0f, A.y + L4 + sqrt(L2 * L2 - L5 * L5 / 4.0f)};
-Vector2 D = {A.x + L5, A.y + L4};
-Vector2 E = {A.x + L5, A.y};
+Vector2 C = {A.x + L5 / 2.0f, A.y + L4 + std::sqrt(L2 * L2 - L5 * L5 / 4.0f)};
+Vector2 D = {ARM_GEOMETRY.ex, ARM_GEOMETRY.ey + L4};
+Vector2 E = {ARM_GEOMETRY.ex, ARM_GEOMETRY.ey};
 
 std::vector<Vector2*> point = {&A, &B, &C, &D, &E};
 
+// jacobian condition number of the drawn pose
+float condition = 1;
+
 bool dragging = false;
+bool showRange = false;
+
+// workspace grid over the whole window, 2 px cells
+const float RANGE_CELL = 2.0f;
+
+WorkspaceMap workspace;
+Texture2D rangeTexture = {};
 
 auto Dist = [](Vector2 a, Vector2 b)
 {
@@ -33,84 +50,83 @@ auto Dist = [](Vector2 a, Vector2 b)
     return sqrt(dx * dx + dy * dy);
 };
 
-void ModelIK(Vector2 mPos)
-{    
-    float rx, ry, d, a, b, t, cd;
- 
-    // point B
-    rx = mPos.x - A.x;
-    ry = mPos.y - A.y;
-
-    d = sqrt(rx * rx + ry * ry);
-    if (d < EP) return;
-    
-    a = atan2(ry, rx);
-
-    cd = std::clamp(d, fabs(L1 - L2), L1 + L2);
+FiveBar Geometry()
+{
+    return {A.x, A.y, E.x, E.y, L1, L2, L3, L4};
+}
 
-    C.x = A.x + cd * cos(a);
-    C.y = A.y + cd * sin(a);
-    
-    b = (L1 * L1 + cd * cd - L2 * L2) / (2.0f * L1 * cd);
-    b = acos(std::clamp(b, -1.0f, 1.0f));
+// holds the last pose when the target is out of reach
+void ModelIK(Vector2 mPos)
+{
+    IKSolution s = SolveIK(Geometry(), mPos.x, mPos.y);
+    if (!s.valid) return;
 
-    t = a + b;
+    B = {s.bx, s.by};
+    C = mPos;
+    D = {s.dx, s.dy};
+}
 
-    B.x = A.x + L1 * cos(t);
-    B.y = A.y + L1 * sin(t);
-    
-    // point D
-    rx = C.x - E.x;
-    ry = C.y - E.y;  
+// the arm runs at the control rate through the time optimal trajectories
+// it is given, and is drawn between control ticks. each waits in armQueue
+// for the one before it to finish, and goes to the motor controller as
+// the simulation starts it
+Simulation sim(Geometry(), CONTROL_HZ, PATH_POINT_RATE);
 
-    d = sqrt(rx * rx + ry * ry);
-    if (d < EP) return;
-    
-    a = atan2(ry, rx);
+void ModelK()
+{
+    if (!armQueue.empty() && sim.finished())
+    {
+        sim.setTrajectory(armQueue.front(), false);
+        if (controller.connected()) controller.send(armQueue.front());
+        armQueue.pop_front();
+    }
 
-    cd = std::clamp(d, fabs(L3 - L4), L3 + L4);
+    sim.advance(GetFrameTime());
 
-    C.x = E.x + cd * cos(a);
-    C.y = E.y + cd * sin(a);
-    
-    b = (L4 * L4 + d * d - L3 * L3) / (2.0f * L4 * d);
-    b = acos(std::clamp(b, -1.0f, 1.0f));
-    
-    t = a - b;
+    ArmState s = sim.interpolated();
 
-    D.x = E.x + L4 * cos(t);
-    D.y = E.y + L4 * sin(t);
+    B = {A.x + L1 * cosf(s.theta1), A.y + L1 * sinf(s.theta1)};
+    C = {s.x, s.y};
+    D = {E.x + L4 * cosf(s.theta2), E.y + L4 * sinf(s.theta2)};
+    condition = s.condition;
 }
 
-void ModelK()
+void InitBar(void)
 {
-    static int step = 0;
+    if (!workspace.load(WORKSPACE_CACHE, Geometry(), 0, 0, WIDTH, HEIGHT, RANGE_CELL))
+        TraceLog(LOG_INFO, "rebuilt workspace map %dx%d", workspace.columns(), workspace.rows());
 
-    if (step < points.size())
+    Image image = GenImageColor(workspace.columns(), workspace.rows(), BLANK);
+
+    for (int j = 0; j < workspace.rows(); j++)
     {
-        Vector2 p = points[step];
-        ModelIK({p.x, p.y});
-        step++;
+        for (int i = 0; i < workspace.columns(); i++)
+        {
+            const WorkspaceCell& c = workspace.cellAt(i, j);
+            if (!(c.flags & WS_REACHABLE)) continue;
+
+            // darker towards singular poses, red where the links would cross
+            unsigned char shade = (unsigned char)(220 - 140 * std::clamp(c.singularity, 0.0f, 1.0f));
+            Color color = (c.flags & WS_COLLISION) ? Color{200, 90, 90, 120} : Color{shade, shade, shade, 120};
+
+            ImageDrawPixel(&image, i, workspace.rows() - 1 - j, color);
+        }
     }
-    else step = 0;
+
+    rangeTexture = LoadTextureFromImage(image);
+    UnloadImage(image);
 }
 
 void UpdateBar(void)
 {
+    if (IsKeyPressed(KEY_R)) showRange = !showRange;
+
     if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) &&
         CheckCollisionPointCircle(GetMousePosition(), {C.x, HEIGHT - C.y}, 10)) dragging = true;
     
     if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) dragging = false;
 
-    static float cTick = 0.0f;
-    static float tick = 0.1f;
-
-    cTick += GetFrameTime();
-    if (cTick >= tick)
-    {
-        cTick = 0.0f;
-        ModelK();
-    }
+    ModelK();
 
     // if (dragging)
     // {
@@ -136,33 +152,21 @@ void DrawRange(void)
     DrawText(TextFormat("l4: %.2f", l4d), 20, 95, 20, BLACK);
     DrawText(TextFormat("l5: %.2f", l5d), 20, 120, 20, BLACK);
 
-    auto Valid = [&](Vector2 p)
-    {
-        float dxA = p.x - A.x;
-        float dyA = p.y - A.y;
-
-        float dxE = p.x - E.x;
-        float dyE = p.y - E.y;
-
-        float dA = dxA * dxA + dyA * dyA;
-        float dE = dxE * dxE + dyE * dyE;
+    float w = workspace.columns() * workspace.cellSize();
+    float h = workspace.rows() * workspace.cellSize();
 
-        return (dA <= R1 * R1 && dE <= R2 * R2);
-    };
-
-    const int step = 7;
-    for (int x = 0; x < WIDTH; x += step)
-    {
-        for (int y = A.y; y < HEIGHT; y += step)
-        {
-            Vector2 p = {(float)x, (float)y};
-            if (Valid(p)) DrawPixel(x, HEIGHT - y, GRAY);
-        }
-    }
+    DrawTexturePro(
+        rangeTexture,
+        {0, 0, (float)rangeTexture.width, (float)rangeTexture.height},
+        {workspace.originX(), HEIGHT - workspace.originY() - h, w, h},
+        {0, 0}, 0, WHITE
+    );
 }
 
 void DrawBar(void)
 {
+    if (showRange) DrawRange();
+
     for (int i = 0; i < 4; ++i)
     {
         Vector2 p1 = *point[i];
@@ -175,4 +179,6 @@ void DrawBar(void)
         Vector2 p = *point[i];
         DrawCircle(p.x, HEIGHT - p.y, 2.5f, (i != 2 ? BLACK : DARKGREEN));
     }
+
+    DrawText(TextFormat("cond: %.1f", condition), WIDTH - 140, 20, 20, BLACK);
 }
\ No newline at end of file
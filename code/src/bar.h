@@ -1,5 +1,10 @@
 #pragma once
 #include <vector>
+#include "workspace.h"
+
+extern WorkspaceMap workspace;
+
+void InitBar(void);
 
 void UpdateBar(void);
 void DrawBar(void);
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "board.h"
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+const char* PIECE_CHARS = "PNBRQKpnbrqk ";
+
+// filled in at compile time, so a board another file builds during static
+// initialisation never hashes with an empty table
+struct Zobrist
+{
+    uint64_t piece[12][64];
+    uint64_t castling[16];
+    uint64_t ep[8];
+    uint64_t side;
+
+    constexpr Zobrist() : piece{}, castling{}, ep{}, side(0)
+    {
+        uint64_t s = 0x9E3779B97F4A7C15ULL;
+
+        auto next = [&]
+        {
+            s ^= s << 13;
+            s ^= s >> 7;
+            s ^= s << 17;
+            return s;
+        };
+
+        for (auto& p : piece) for (uint64_t& k : p) k = next();
+        for (uint64_t& k : castling) k = next();
+        for (uint64_t& k : ep) k = next();
+        side = next();
+    }
+};
+
+static constexpr Zobrist zobrist;
+
+// castling rights kept after a move touches each square
+static constexpr struct CastlingMask
+{
+    uint8_t keep[64];
+
+    constexpr CastlingMask() : keep{}
+    {
+        for (uint8_t& k : keep) k = 15;
+        keep[4] &= ~(WHITE_OO | WHITE_OOO);
+        keep[60] &= ~(BLACK_OO | BLACK_OOO);
+        keep[7] &= ~WHITE_OO;
+        keep[0] &= ~WHITE_OOO;
+        keep[63] &= ~BLACK_OO;
+        keep[56] &= ~BLACK_OOO;
+    }
+} castlingMask;
+
+int ParseSquare(const char* s)
+{
+    if (s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8') return -1;
+
+    return MakeSquare(s[0] - 'a', s[1] - '1');
+}
+
+void MoveToUci(Move m, char* out)
+{
+    out[0] = 'a' + SquareFile(m.from);
+    out[1] = '1' + SquareRank(m.from);
+    out[2] = 'a' + SquareFile(m.to);
+    out[3] = '1' + SquareRank(m.to);
+    out[4] = m.promotion ? "pnbrqk"[m.promotion] : '\0';
+    out[5] = '\0';
+}
+
+std::string MoveToUci(Move m)
+{
+    char buffer[6];
+    MoveToUci(m, buffer);
+
+    return buffer;
+}
+
+void Board::clear()
+{
+    memset(pieces, 0, sizeof(pieces));
+    memset(colors, 0, sizeof(colors));
+    memset(mailbox, NO_PIECE, sizeof(mailbox));
+    occupied = 0;
+}
+
+void Board::put(int piece, int sq)
+{
+    Bitboard b = SquareBit(sq);
+
+    pieces[piece] |= b;
+    colors[PieceSide(piece)] |= b;
+    occupied |= b;
+    mailbox[sq] = piece;
+    hash ^= zobrist.piece[piece][sq];
+}
+
+void Board::remove(int sq)
+{
+    int piece = mailbox[sq];
+    Bitboard b = SquareBit(sq);
+
+    pieces[piece] &= ~b;
+    colors[PieceSide(piece)] &= ~b;
+    occupied &= ~b;
+    mailbox[sq] = NO_PIECE;
+    hash ^= zobrist.piece[piece][sq];
+}
+
+uint64_t Board::computeHash() const
+{
+    uint64_t h = 0;
+
+    for (int sq = 0; sq < 64; sq++)
+        if (mailbox[sq] != NO_PIECE) h ^= zobrist.piece[mailbox[sq]][sq];
+
+    h ^= zobrist.castling[castling];
+    if (ep >= 0) h ^= zobrist.ep[SquareFile(ep)];
+    if (side == SIDE_BLACK) h ^= zobrist.side;
+
+    return h;
+}
+
+void Board::reset()
+{
+    setFen(START_FEN);
+}
+
+bool Board::setFen(const std::string& text)
+{
+    std::istringstream in(text);
+    // the rights and en passant fields may be left off, a failed read
+    // leaves the default
+    std::string placement, color, rights = "-", epText = "-";
+
+    if (!(in >> placement >> color)) return false;
+    in >> rights >> epText;
+    if (!(in >> halfmove)) halfmove = 0;
+    if (!(in >> fullmove)) fullmove = 1;
+
+    clear();
+
+    int file = 0, rank = 7;
+
+    for (char c : placement)
+    {
+        const char* p = strchr(PIECE_CHARS, c);
+
+        if (c == '/') { file = 0; rank--; }
+        else if (isdigit(c)) file += c - '0';
+        else if (p && c != ' ' && file < 8 && rank >= 0) put(p - PIECE_CHARS, MakeSquare(file++, rank));
+        else return false;
+    }
+
+    side = color == "b" ? SIDE_BLACK : SIDE_WHITE;
+
+    castling = 0;
+    for (char c : rights)
+    {
+        if (c == 'K') castling |= WHITE_OO;
+        else if (c == 'Q') castling |= WHITE_OOO;
+        else if (c == 'k') castling |= BLACK_OO;
+        else if (c == 'q') castling |= BLACK_OOO;
+    }
+
+    ep = epText == "-" ? -1 : ParseSquare(epText.c_str());
+    hash = computeHash();
+
+    return pieces[WK] && pieces[BK];
+}
+
+void Board::fen(std::string& out) const
+{
+    out.clear();
+
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+
+        for (int file = 0; file < 8; file++)
+        {
+            int p = mailbox[MakeSquare(file, rank)];
+
+            if (p == NO_PIECE) { empty++; continue; }
+            if (empty) out += char('0' + empty);
+
+            empty = 0;
+            out += PIECE_CHARS[p];
+        }
+
+        if (empty) out += char('0' + empty);
+        if (rank) out += '/';
+    }
+
+    out += side == SIDE_WHITE ? " w " : " b ";
+
+    if (!castling) out += '-';
+    if (castling & WHITE_OO) out += 'K';
+    if (castling & WHITE_OOO) out += 'Q';
+    if (castling & BLACK_OO) out += 'k';
+    if (castling & BLACK_OOO) out += 'q';
+
+    out += ' ';
+
+    if (ep < 0) out += '-';
+    else
+    {
+        out += char('a' + SquareFile(ep));
+        out += char('1' + SquareRank(ep));
+    }
+
+    char clocks[24];
+    snprintf(clocks, sizeof(clocks), " %d %d", halfmove, fullmove);
+    out += clocks;
+}
+
+char Board::pieceAt(int sq) const
+{
+    return PIECE_CHARS[mailbox[sq]];
+}
+
+bool Board::decodeUci(const std::string& uci, Move& m) const
+{
+    if (uci.size() < 4) return false;
+
+    int from = ParseSquare(&uci[0]);
+    int to = ParseSquare(&uci[2]);
+
+    if (from < 0 || to < 0 || mailbox[from] == NO_PIECE) return false;
+
+    m = {};
+    m.from = from;
+    m.to = to;
+
+    int kind = PieceKind(mailbox[from]);
+
+    if (uci.size() >= 5 && kind == PAWN)
+    {
+        const char* p = strchr("nbrq", tolower(uci[4]));
+        if (!p || !uci[4]) return false;
+        m.promotion = KNIGHT + (p - "nbrq");
+    }
+
+    if (mailbox[to] != NO_PIECE) m.flags |= MOVE_CAPTURE;
+    if (kind == PAWN && to == ep) m.flags |= MOVE_EP | MOVE_CAPTURE;
+    if (kind == PAWN && abs(to - from) == 16) m.flags |= MOVE_DOUBLE;
+    if (kind == KING && abs(SquareFile(to) - SquareFile(from)) == 2) m.flags |= MOVE_CASTLE;
+
+    return true;
+}
+
+bool Board::applyUci(const std::string& uci)
+{
+    Move m;
+    Undo u;
+
+    if (!decodeUci(uci, m)) return false;
+
+    make(m, u);
+    return true;
+}
+
+bool Board::isIrreversible(Move m) const
+{
+    return (m.flags & MOVE_CAPTURE) || PieceKind(mailbox[m.from]) == PAWN;
+}
+
+bool Board::isIrreversible(const std::string& uci) const
+{
+    Move m;
+    return decodeUci(uci, m) && isIrreversible(m);
+}
+
+void Board::make(Move m, Undo& u)
+{
+    int piece = mailbox[m.from];
+
+    u.move = m;
+    u.captured = NO_PIECE;
+    u.ep = ep;
+    u.castling = castling;
+    u.halfmove = halfmove;
+    u.hash = hash;
+
+    hash ^= zobrist.castling[castling];
+    if (ep >= 0) hash ^= zobrist.ep[SquareFile(ep)];
+
+    if (m.flags & MOVE_EP)
+    {
+        int sq = m.to ^ 8;
+        u.captured = mailbox[sq];
+        remove(sq);
+    }
+    else if (mailbox[m.to] != NO_PIECE)
+    {
+        u.captured = mailbox[m.to];
+        remove(m.to);
+    }
+
+    remove(m.from);
+    put(m.promotion ? MakePiece(side, m.promotion) : piece, m.to);
+
+    if (m.flags & MOVE_CASTLE)
+    {
+        bool kingSide = m.to > m.from;
+        int rookFrom = kingSide ? m.to + 1 : m.to - 2;
+        int rookTo = kingSide ? m.to - 1 : m.to + 1;
+
+        int rook = mailbox[rookFrom];
+        remove(rookFrom);
+        put(rook, rookTo);
+    }
+
+    castling &= castlingMask.keep[m.from] & castlingMask.keep[m.to];
+    ep = (m.flags & MOVE_DOUBLE) ? (m.from + m.to) / 2 : -1;
+
+    hash ^= zobrist.castling[castling];
+    if (ep >= 0) hash ^= zobrist.ep[SquareFile(ep)];
+
+    halfmove = (PieceKind(piece) == PAWN || u.captured != NO_PIECE) ? 0 : halfmove + 1;
+    if (side == SIDE_BLACK) fullmove++;
+
+    side ^= 1;
+    hash ^= zobrist.side;
+}
+
+void Board::unmake(const Undo& u)
+{
+    Move m = u.move;
+
+    side ^= 1;
+    if (side == SIDE_BLACK) fullmove--;
+
+    int piece = m.promotion ? MakePiece(side, PAWN) : mailbox[m.to];
+
+    if (m.flags & MOVE_CASTLE)
+    {
+        bool kingSide = m.to > m.from;
+        int rookFrom = kingSide ? m.to + 1 : m.to - 2;
+        int rookTo = kingSide ? m.to - 1 : m.to + 1;
+
+        int rook = mailbox[rookTo];
+        remove(rookTo);
+        put(rook, rookFrom);
+    }
+
+    remove(m.to);
+    put(piece, m.from);
+
+    if (u.captured != NO_PIECE) put(u.captured, (m.flags & MOVE_EP) ? m.to ^ 8 : m.to);
+
+    ep = u.ep;
+    castling = u.castling;
+    halfmove = u.halfmove;
+    hash = u.hash;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+typedef uint64_t Bitboard;
+
+extern const char* const START_FEN;
+
+enum Side
+{
+    SIDE_WHITE,
+    SIDE_BLACK
+};
+
+enum PieceType
+{
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+
+// white pieces 0..5, black pieces 6..11
+enum Piece
+{
+    WP, WN, WB, WR, WQ, WK,
+    BP, BN, BB, BR, BQ, BK,
+    NO_PIECE
+};
+
+enum Castling
+{
+    WHITE_OO = 1,
+    WHITE_OOO = 2,
+    BLACK_OO = 4,
+    BLACK_OOO = 8
+};
+
+enum MoveFlags
+{
+    MOVE_CAPTURE = 1,
+    MOVE_DOUBLE = 2,
+    MOVE_EP = 4,
+    MOVE_CASTLE = 8
+};
+
+// square index: a1 = 0, h1 = 7, a8 = 56, h8 = 63
+inline int SquareFile(int sq) { return sq & 7; }
+inline int SquareRank(int sq) { return sq >> 3; }
+inline int MakeSquare(int file, int rank) { return rank * 8 + file; }
+
+inline Bitboard SquareBit(int sq) { return 1ULL << sq; }
+inline int PopLsb(Bitboard& b) { int sq = __builtin_ctzll(b); b &= b - 1; return sq; }
+inline int PopCount(Bitboard b) { return __builtin_popcountll(b); }
+
+inline int MakePiece(int color, int type) { return color * 6 + type; }
+inline int PieceSide(int piece) { return piece / 6; }
+inline int PieceKind(int piece) { return piece % 6; }
+
+int ParseSquare(const char* s);
+
+struct Move
+{
+    uint8_t from = 0;
+    uint8_t to = 0;
+    uint8_t promotion = 0;   // piece type, 0 when not promoting
+    uint8_t flags = 0;
+
+    bool operator==(const Move& o) const { return from == o.from && to == o.to && promotion == o.promotion; }
+    bool operator!=(const Move& o) const { return !(*this == o); }
+};
+
+// writes "e2e4" / "e7e8q" into out, which needs room for 6 chars
+void MoveToUci(Move m, char* out);
+std::string MoveToUci(Move m);
+
+struct Undo
+{
+    Move move;
+    uint8_t captured = NO_PIECE;
+    int8_t ep = -1;
+    uint8_t castling = 0;
+    uint16_t halfmove = 0;
+    uint64_t hash = 0;
+};
+
+class Board
+{
+public:
+    Board() { reset(); }
+
+    void reset();
+    bool setFen(const std::string& fen);
+    void fen(std::string& out) const;
+
+    // fills in flags from the current position, no legality checks
+    bool decodeUci(const std::string& uci, Move& m) const;
+    bool applyUci(const std::string& uci);
+    bool isIrreversible(Move m) const;
+    bool isIrreversible(const std::string& uci) const;
+
+    void make(Move m, Undo& u);
+    void unmake(const Undo& u);
+
+    char pieceAt(int sq) const;
+    int pieceOn(int sq) const { return mailbox[sq]; }
+
+    Bitboard piecesOf(int piece) const { return pieces[piece]; }
+    Bitboard piecesOf(int color, int type) const { return pieces[MakePiece(color, type)]; }
+    Bitboard colorBits(int color) const { return colors[color]; }
+    Bitboard occupancy() const { return occupied; }
+
+    int sideToMove() const { return side; }
+    bool whiteToMove() const { return side == SIDE_WHITE; }
+    int castlingRights() const { return castling; }
+    int epSquare() const { return ep; }
+    int halfmoveClock() const { return halfmove; }
+    int fullmoveNumber() const { return fullmove; }
+    uint64_t key() const { return hash; }
+
+    int kingSquare(int color) const { return __builtin_ctzll(pieces[MakePiece(color, KING)]); }
+
+private:
+    void clear();
+    void put(int piece, int sq);
+    void remove(int sq);
+    uint64_t computeHash() const;
+
+    Bitboard pieces[12];
+    Bitboard colors[2];
+    Bitboard occupied;
+    uint8_t mailbox[64];
+
+    int side = SIDE_WHITE;
+    int castling = 0;
+    int ep = -1;
+    int halfmove = 0;
+    int fullmove = 1;
+    uint64_t hash = 0;
+};
@@ -0,0 +1,177 @@
+#include <cstring>
+#include "cache.h"
+
+TrajectoryCache trajectoryCache(1024);
+
+static uint64_t Mix(uint64_t h, uint64_t v)
+{
+    // splitmix64 finaliser over the running hash
+    h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+
+    return h;
+}
+
+static uint64_t MixBytes(uint64_t h, const void* data, size_t n)
+{
+    const unsigned char* p = (const unsigned char*)data;
+
+    for (size_t i = 0; i < n; i += 8)
+    {
+        uint64_t v = 0;
+        memcpy(&v, p + i, std::min((size_t)8, n - i));
+        h = Mix(h, v);
+    }
+
+    return h;
+}
+
+// the window is the bounding box of the two cells grown by a square
+static void Window(Cell from, Cell to, int& f0, int& f1, int& r0, int& r1)
+{
+    f0 = std::min(from.file, to.file) - 1;
+    f1 = std::max(from.file, to.file) + 1;
+    r0 = std::min(from.rank, to.rank) - 1;
+    r1 = std::max(from.rank, to.rank) + 1;
+}
+
+uint64_t TrajectoryCache::key(Cell from, Cell to, Bitboard occupied, uint64_t offBoard)
+{
+    int f0, f1, r0, r1;
+    Window(from, to, f0, f1, r0, r1);
+
+    Bitboard board = 0;
+    uint64_t graves = 0;
+
+    for (int rank = r0; rank <= r1; rank++)
+    {
+        for (int file = f0; file <= f1; file++)
+        {
+            if (file >= 0 && file < 8 && rank >= 0 && rank < 8) board |= SquareBit(MakeSquare(file, rank));
+            else graves |= GraveyardBit({file, rank});
+        }
+    }
+
+    uint64_t h = Mix(0, (uint64_t)(uint8_t)from.file | (uint64_t)(uint8_t)from.rank << 8 |
+                            (uint64_t)(uint8_t)to.file << 16 | (uint64_t)(uint8_t)to.rank << 24);
+    h = Mix(h, occupied & board);
+    h = Mix(h, offBoard & graves);
+
+    // 0 is kept for legs that are not cached
+    return h ? h : 1;
+}
+
+void TrajectoryCache::calibrate(const FiveBar& g)
+{
+    uint64_t h = MixBytes(0, &g, sizeof(g));
+    h = Mix(h, (uint64_t)(uint32_t)squareSize | (uint64_t)(uint32_t)offsetX << 32);
+    h = Mix(h, (uint64_t)(uint32_t)offsetY);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (h == calibration) return;
+
+    calibration = h;
+    order.clear();
+    index.clear();
+}
+
+TrajectoryCache::Entry* TrajectoryCache::touch(uint64_t key)
+{
+    auto it = index.find(key);
+    if (it == index.end()) return nullptr;
+
+    order.splice(order.begin(), order, it->second);
+
+    return &*it->second;
+}
+
+bool TrajectoryCache::findPath(uint64_t key, std::vector<Vector2>& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry* e = touch(key);
+    if (!e) return false;
+
+    path = e->path;
+
+    return true;
+}
+
+void TrajectoryCache::storePath(uint64_t key, Cell from, Cell to, const std::vector<Vector2>& path)
+{
+    int f0, f1, r0, r1;
+    Window(from, to, f0, f1, r0, r1);
+
+    // a route that leaves the window crosses squares the key does not cover
+    for (const Vector2& p : path)
+    {
+        float file = (p.x - offsetX) / squareSize, rank = (p.y - offsetY) / squareSize;
+        if (file < f0 - 1e-3f || file > f1 + 1 + 1e-3f || rank < r0 - 1e-3f || rank > r1 + 1 + 1e-3f) return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (Entry* e = touch(key))
+    {
+        e->path = path;
+        e->trajectory.reset();
+        return;
+    }
+
+    order.push_front({key, path, nullptr, 0});
+    index[key] = order.begin();
+
+    if (order.size() > capacity)
+    {
+        index.erase(order.back().key);
+        order.pop_back();
+    }
+}
+
+static uint64_t SolvedFor(const MotorLimits& limits, double dt)
+{
+    return Mix(MixBytes(0, &limits, sizeof(limits)), MixBytes(0, &dt, sizeof(dt)));
+}
+
+std::shared_ptr<const Trajectory> TrajectoryCache::findTrajectory(uint64_t key, const MotorLimits& limits, double dt)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry* e = touch(key);
+
+    if (!e || !e->trajectory || e->solvedFor != SolvedFor(limits, dt))
+    {
+        missCount++;
+        return nullptr;
+    }
+
+    hitCount++;
+
+    return e->trajectory;
+}
+
+void TrajectoryCache::storeTrajectory(uint64_t key, const MotorLimits& limits, double dt, std::shared_ptr<const Trajectory> traj)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Entry* e = touch(key);
+    if (!e) return;
+
+    e->trajectory = std::move(traj);
+    e->solvedFor = SolvedFor(limits, dt);
+}
+
+void TrajectoryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    order.clear();
+    index.clear();
+    hitCount = 0;
+    missCount = 0;
+}
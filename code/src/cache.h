@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <raylib.h>
+#include "kinematics.h"
+#include "plan.h"
+#include "trajectory.h"
+
+// routed legs and their solved trajectories, least recently used dropped
+// first. a leg is keyed by its end cells and the pieces standing in the
+// window one square around them, and only kept when its route stays in
+// that window, so the key covers every square the route relies on being
+// empty. the whole cache goes when the arm or the board is recalibrated,
+// and a trajectory also carries the limits and rate it was solved for
+class TrajectoryCache
+{
+public:
+    explicit TrajectoryCache(size_t capacity) : capacity(capacity) {}
+
+    // key for the leg from to to with the given pieces standing
+    static uint64_t key(Cell from, Cell to, Bitboard occupied, uint64_t offBoard);
+
+    // drops everything when the geometry or board placement differs from
+    // what the cached legs were planned for
+    void calibrate(const FiveBar& g);
+
+    bool findPath(uint64_t key, std::vector<Vector2>& path);
+    void storePath(uint64_t key, Cell from, Cell to, const std::vector<Vector2>& path);
+
+    // counted as a hit or a miss
+    std::shared_ptr<const Trajectory> findTrajectory(uint64_t key, const MotorLimits& limits, double dt);
+    void storeTrajectory(uint64_t key, const MotorLimits& limits, double dt, std::shared_ptr<const Trajectory> traj);
+
+    void clear();
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    size_t size() const { return order.size(); }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        std::vector<Vector2> path;
+        std::shared_ptr<const Trajectory> trajectory;
+        uint64_t solvedFor = 0;
+    };
+
+    Entry* touch(uint64_t key);
+
+    size_t capacity;
+    uint64_t calibration = 0;
+
+    std::mutex mutex;
+    std::list<Entry> order;   // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+};
+
+extern TrajectoryCache trajectoryCache;
@@ -1,227 +1,179 @@
 #include <raylib.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include "chess.h"
+#include "bar.h"
+#include "board.h"
+#include "movegen.h"
+#include "plan.h"
+#include "ponder.h"
 #include "stockfish.h"
+#include "trajectory.h"
+#include "uci.h"
 #include "config.h"
 
-struct Vector2i
-{
-    int x;
-    int y;
-};
-
-struct Move
-{
-    Vector2i from;
-    Vector2i to;
-    char promotion = 0;
-};
-
-int squareSize = 32;
 int fontSize = 20;
 
-int boardSize = 8 * squareSize;
-int offsetX = (WIDTH  - boardSize) / 2;
-int offsetY = (HEIGHT - boardSize) / 2;
-
 std::vector<Vector2> points;
 std::vector<std::string> moves;
+std::deque<Trajectory> armQueue;
 
-std::pair<char, bool> mat[8][8] =
-{
-    {{'r', 0}, {'n', 0}, {'b', 0}, {'q', 0}, {'k', 0}, {'b', 0}, {'n', 0}, {'r', 0}},
-    {{'p', 0}, {'p', 0}, {'p', 0}, {'p', 0}, {'p', 0}, {'p', 0}, {'p', 0}, {'p', 0}},
-    {{' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}},
-    {{' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}},
-    {{' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}},
-    {{' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}, {' ', 0}},
-    {{'p', 1}, {'p', 1}, {'p', 1}, {'p', 1}, {'p', 1}, {'p', 1}, {'p', 1}, {'p', 1}},
-    {{'r', 1}, {'n', 1}, {'b', 1}, {'q', 1}, {'k', 1}, {'b', 1}, {'n', 1}, {'r', 1}}
-};
-
-float EaseInOut(float t)
-{
-    return (t < 0.5f)
-        ? 2.0f * t * t
-        : 1.0f - pow(-2.0f * t + 2.0f, 2.0f) / 2.0f;
-}
+EngineFuture pending;
+int selected = -1;
 
-std::vector<char> GenerateMove(Move m)
-{
-    std::vector<char> dirs;
-
-    int sX = m.from.x;
-    int sY = m.from.y;
-    int eX = m.to.x;
-    int eY = m.to.y;
-
-    while (sX != eX || sY != eY) {
-        if (sY < eY) { dirs.push_back('U'); sY++; }
-        else if (sY > eY) { dirs.push_back('D'); sY--; }
-        else if (sX < eX) { dirs.push_back('R'); sX++; }
-        else if (sX > eX) { dirs.push_back('L'); sX--; }
-    }
+Board board;
+PositionCommand position;
+Graveyard graveyard;
 
-    return dirs;
-}
+// where the end effector is left by the last thing the arm was given
+Vector2 arm = ARM_HOME;
 
-std::vector<Vector2> GetEdgePath(const std::vector<char>& dirs, Move m)
+// sets the arm off on an empty transit to p
+void MoveArm(Vector2 p)
 {
-    std::vector<Vector2> vec;
-
-    int startCol = m.from.x;
-    int startRow = 7 - m.from.y;
-    int endCol = m.to.x;
-    int endRow = 7 - m.to.y;
-
-    float startCX = offsetX + startCol * squareSize + squareSize / 2.0f;
-    float startCY = offsetY + startRow * squareSize + squareSize / 2.0f;
-
-    float endCX = offsetX + endCol * squareSize + squareSize / 2.0f;
-    float endCY = offsetY + endRow * squareSize + squareSize / 2.0f;
+    points = {arm, p};
+    armQueue.push_back(TimeOptimal(ARM_GEOMETRY, points, TRANSIT_LIMITS, 1.0 / CONTROL_HZ));
+    arm = p;
+}
 
-    float midX = (startCX + endCX) / 2.0f;
-    float midY = (startCY + endCY) / 2.0f;
+// while the engine ponders, the arm for the move it expects and its reply
+// to it is planned in the background
+LinePlanner ahead;
+std::string expected;
+std::string preparedReply;
 
-    vec.push_back({startCX, startCY});
+// every move goes through the legal move generator before the arm is planned
+bool PlayMove(const std::string& uci)
+{
+    Move m;
+    Undo u;
+    PreparedMove p;
 
-    int col = startCol;
-    int row = startRow;
+    if (!ValidateUci(board, uci, m)) return false;
 
-    for (size_t i = 0; i < dirs.size(); i++)
+    if (ahead.take(board, MoveToUci(m), p) && p.plan.start.x == arm.x && p.plan.start.y == arm.y)
     {
-        float cx = offsetX + col * squareSize + squareSize / 2.0f;
-        float cy = offsetY + row * squareSize + squareSize / 2.0f;
-
-        float dx = (midX >= cx) ? squareSize / 2.0f : -squareSize / 2.0f;
-        float dy = (midY >= cy) ? squareSize / 2.0f : -squareSize / 2.0f;
-
-        vec.push_back({cx + dx, cy + dy});
-
-        char d = dirs[i];
-
-        if (d == 'U' && row > 0) row--;
-        else if (d == 'D' && row < 7) row++;
-        else if (d == 'L' && col > 0) col--;
-        else if (d == 'R' && col < 7) col++;
+        points = std::move(p.points);
+        armQueue.push_back(std::move(p.trajectory));
+        graveyard = p.graveyard;
+        arm = PlanEnd(p.plan);
     }
-
-    float cx = offsetX + col * squareSize + squareSize / 2.0f;
-    float cy = offsetY + row * squareSize + squareSize / 2.0f;
-
-    float dx = (midX >= cx) ? squareSize / 2.0f : -squareSize / 2.0f;
-    float dy = (midY >= cy) ? squareSize / 2.0f : -squareSize / 2.0f;
-
-    vec.push_back({cx + dx, cy + dy});
-    vec.push_back({endCX, endCY});
-
-    vec.erase(
-    std::unique(vec.begin(), vec.end(),
-        [](const Vector2& a, const Vector2& b)
-        {
-            const float eps = 0.0001f;
-            return fabs(a.x - b.x) < eps && fabs(a.y - b.y) < eps;
-        }),
-    vec.end());
-
-    return vec;
-}
-
-std::vector<Vector2> BuildEasedCycle(const std::vector<Vector2>& base, int stepsPerSegment)
-{
-    std::vector<Vector2> result;
-
-    if (base.size() < 2) return base;
-
-    for (size_t i = 0; i < base.size() - 1; i++)
+    else
     {
-        Vector2 a = base[i];
-        Vector2 b = base[i + 1];
+        MovePlan plan = PlanMove(board, m, graveyard, &arm);
 
-        for (int s = 0; s < stepsPerSegment; s++)
+        if (plan.legs.empty())
         {
-            float t = (float)s / (float)stepsPerSegment;
-            t = EaseInOut(t);
-
-            Vector2 p;
-            p.x = a.x + (b.x - a.x) * t;
-            p.y = a.y + (b.y - a.y) * t;
-
-            result.push_back(p);
+            TraceLog(LOG_WARNING, "%s: no reachable graveyard slot for the captured piece", uci.c_str());
+            return false;
         }
+
+        points = BuildPlanPath(plan);
+        armQueue.push_back(PlanTrajectory(ARM_GEOMETRY, plan, MOTOR_LIMITS, TRANSIT_LIMITS, 1.0 / CONTROL_HZ));
+        arm = PlanEnd(plan);
     }
 
-    result.push_back(base.back());
+    int blocked = 0;
+    for (const Vector2& p : points) if (!workspace.empty() && !workspace.feasible(p.x, p.y)) blocked++;
+    if (blocked) TraceLog(LOG_WARNING, "%s: %d of %zu path points outside the workspace", uci.c_str(), blocked, points.size());
+
+    bool irreversible = board.isIrreversible(m);
+
+    moves.push_back(MoveToUci(m));
+    board.make(m, u);
+    position.push(board, moves.back(), irreversible);
 
-    return result;
+    return true;
 }
 
-Move ParseMove(const std::string& uci)
+// searches the position after the move the engine expects the player to
+// answer with, until the player makes it or not
+void StartPonder(const std::string& guess)
 {
+    Board after = board;
+    PositionCommand line = position;
     Move m;
+    Undo u;
 
-    m.from.x = uci[0] - 'a';
-    m.from.y = 8 - (uci[1] - '0');
+    if (!ValidateUci(after, guess, m)) return;
 
-    m.to.x = uci[2] - 'a';
-    m.to.y = 8 - (uci[3] - '0');
+    bool irreversible = after.isIrreversible(m);
+    after.make(m, u);
+    line.push(after, MoveToUci(m), irreversible);
 
-    if (uci.length() == 5) m.promotion = uci[4];
+    pending = sf.go(line.build(), 250, true);
+    if (!pending.valid()) return;
 
-    return m;
+    expected = MoveToUci(m);
+    preparedReply.clear();
+    ahead.prepare(board, graveyard, arm, {expected});
 }
 
-void ApplyMoveToBoard(Move m)
+void EngineMove(const EngineResult& result)
 {
-    auto piece = mat[m.from.y][m.from.x];
-
-    mat[m.to.y][m.to.x] = piece;
-    mat[m.from.y][m.from.x] = {' ', 0};
+    if (!PlayMove(result.bestmove))
+    {
+        TraceLog(LOG_WARNING, "rejected engine move: %s", result.bestmove.c_str());
+        return;
+    }
 
-    if (m.promotion) mat[m.to.y][m.to.x].first = m.promotion;
+    if (!result.ponder.empty()) StartPonder(result.ponder);
 }
 
-std::string GetEngineMove(const std::vector<std::string>& moves)
+void PlayerMove(int from, int to)
 {
-    std::string cmd = "position startpos moves ";
+    char uci[6];
 
-    for (const std::string& m : moves) cmd += m + " ";
+    Move m;
+    m.from = from;
+    m.to = to;
+    MoveToUci(m, uci);
 
-    sf.send(cmd);
-    sf.send("go movetime 250");
+    // promotions default to a queen
+    int rank = SquareRank(to);
+    if (PieceKind(board.pieceOn(from)) == PAWN && (rank == 0 || rank == 7))
+    {
+        uci[4] = 'q';
+        uci[5] = '\0';
+    }
 
-    std::string line;
+    // PlayMove would wait for the planner to finish a line it has no use
+    // for when the player went another way
+    Move legal;
+    if (pending.pondering() && expected != uci && ValidateUci(board, uci, legal)) ahead.cancel();
 
-    while (true)
+    if (!PlayMove(uci))
     {
-        line = sf.readLine();
-        if (line.find("bestmove") != std::string::npos) return line.substr(9, 4);
+        TraceLog(LOG_INFO, "illegal move: %s", uci);
+        return;
     }
-}
 
-// void PlayerMove(const std::string& move)
-// {
-//     moves.push_back(move);
-//     ApplyMoveToBoard(move);
-// }
+    // the engine is already on the reply when the player made the move it
+    // expected, otherwise the search is for the wrong position
+    if (pending.pondering())
+    {
+        if (moves.back() == expected) pending.ponderHit();
+        else
+        {
+            pending.cancel();
+            ahead.cancel();
+        }
+    }
+}
 
-void EngineMove()
+int SquareUnderMouse()
 {
-    std::string uci = GetEngineMove(moves);
-    Move m = ParseMove(uci);
+    Vector2 mPos = GetMousePosition();
 
-    points = BuildEasedCycle(GetEdgePath(GenerateMove(m), m), 4);
+    int col = (int)floorf((mPos.x - offsetX) / squareSize);
+    int row = (int)floorf((mPos.y - offsetY) / squareSize);
 
-    moves.push_back(uci);
-    ApplyMoveToBoard(m);
-}
+    if (col < 0 || col > 7 || row < 0 || row > 7) return -1;
 
-// void PlayTurn(const std::string& playerMove)
-// {
-//     PlayerMove(playerMove);
-//     EngineMove();
-// }
+    return MakeSquare(col, 7 - row);
+}
 
 void DrawMoveList()
 {
@@ -248,7 +200,48 @@ void DrawMoveList()
 
 void UpdateChess(void)
 {
-    if (IsKeyPressed(KEY_SPACE)) EngineMove();
+    // the arm heads for the engine's pieces while it thinks, so the reply
+    // starts closer to wherever it moves
+    if (IsKeyPressed(KEY_SPACE) && !pending.valid())
+    {
+        pending = sf.go(position.build(), 250);
+
+        if (pending.valid()) MoveArm(ParkPoint(board));
+        else TraceLog(LOG_WARNING, "the engine is not running, no search started");
+    }
+
+    if (IsKeyPressed(KEY_BACKSPACE) && pending.valid()) pending.cancel();
+
+    // keep the plan for the engine's current choice of reply up to date
+    if (pending.pondering() && !pending.get().pv.empty() && pending.get().pv != preparedReply)
+    {
+        preparedReply = pending.get().pv;
+        ahead.prepare(board, graveyard, arm, {expected, preparedReply});
+    }
+
+    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && (!pending.valid() || pending.pondering()))
+    {
+        int sq = SquareUnderMouse();
+        int piece = sq >= 0 ? board.pieceOn(sq) : NO_PIECE;
+
+        if (piece != NO_PIECE && PieceSide(piece) == board.sideToMove()) selected = sq;
+        else if (selected >= 0 && sq >= 0)
+        {
+            PlayerMove(selected, sq);
+            selected = -1;
+        }
+        else selected = -1;
+    }
+
+    if (pending.valid() && pending.ready())
+    {
+        // taken off first, playing the move may start the next search
+        EngineResult result = pending.get();
+        bool failed = pending.failed();
+        pending = {};
+
+        if (!failed) EngineMove(result);
+    }
 }
 
 void DrawChess(void)
@@ -265,6 +258,9 @@ void DrawChess(void)
                 offsetY + row * squareSize,
                 squareSize, squareSize, tileColor
             );
+
+            if (MakeSquare(col, 7 - row) == selected)
+                DrawRectangleLines(offsetX + col * squareSize, offsetY + row * squareSize, squareSize, squareSize, DARKGREEN);
         }
     }
 
@@ -272,15 +268,15 @@ void DrawChess(void)
     {
         for (int col = 0; col < 8; ++col)
         {
-            char piece = mat[row][col].first;
+            char piece = board.pieceAt(MakeSquare(col, 7 - row));
 
             if (piece == ' ') continue;
 
-            bool isWhite = mat[row][col].second;
+            bool isWhite = isupper(piece);
             Color pieceColor = isWhite ? WHITE : BLACK;
 
             DrawText(
-                TextFormat("%c", piece),
+                TextFormat("%c", tolower(piece)),
                 offsetX + col * squareSize + squareSize / 3,
                 offsetY + row * squareSize + squareSize / 4,
                 fontSize,
@@ -291,4 +287,11 @@ void DrawChess(void)
 
     for (const Vector2& p : points) DrawCircleV({p.x, HEIGHT - p.y}, 2.5f, MAROON);
     DrawMoveList();
+
+    if (pending.valid())
+    {
+        const EngineResult& r = pending.get();
+        const char* what = pending.pondering() ? "pondering" : "thinking";
+        DrawText(TextFormat("%s... depth %d %s", what, r.depth, r.pv.c_str()), offsetX, offsetY - 30, 18, BLACK);
+    }
 }
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
+#include <deque>
 #include <vector>
+#include "trajectory.h"
 
+// the path of the last thing the arm was given, for drawing
 extern std::vector<Vector2> points;
 
+// trajectories the arm has been given and not started yet, in order.
+// each starts where the one before it ends
+extern std::deque<Trajectory> armQueue;
+
 void UpdateChess(void);
 void DrawChess(void);
\ No newline at end of file
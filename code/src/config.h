@@ -1,4 +1,44 @@
 #pragma once
+#include "kinematics.h"
+#include "steps.h"
+#include "trajectory.h"
 
 const int HEIGHT = 700;
-const int WIDTH = 600;
\ No newline at end of file
+const int WIDTH = 600;
+
+// simulated linkage: motors 90 apart, centred, 160 links. the window's
+// arm in bar.cpp starts from this one too
+const FiveBar ARM_GEOMETRY = {(WIDTH - 90) / 2.0f, HEIGHT / 3.5f, (WIDTH + 90) / 2.0f, HEIGHT / 3.5f, 160, 160, 160, 160};
+
+// motor control loop rate, and how fast planned path samples are played back
+const double CONTROL_HZ = 1000.0;
+const double PATH_POINT_RATE = 10.0;
+
+// joint limits the trajectory planner works to, rad/s, rad/s^2, rad/s^3
+const MotorLimits MOTOR_LIMITS = {8.0f, 60.0f, 3000.0f};
+
+// the empty arm drags nothing and can run harder
+const MotorLimits TRANSIT_LIMITS = {12.0f, 100.0f, 5000.0f};
+
+// 200 step motors at 16 microsteps through a 4:1 belt, 12800 microsteps a
+// joint turn, so the transit limit is 24k steps a second. the step timer
+// runs at 2 mhz
+const StepperConfig STEPPERS = {200, 16, 4.0f, 2000000};
+
+// end effector where the simulation starts the arm, a link length out
+// between the motors
+const Vector2 ARM_HOME = {WIDTH / 2.0f, HEIGHT / 3.5f + 160};
+
+// serial rate to the motor controller, 2.7x what a 1 khz setpoint stream needs
+const int CONTROLLER_BAUD = 115200;
+
+const char* const WORKSPACE_CACHE = "workspace.bin";
+
+// all pairs trajectories, written by 5bar_table
+const char* const TRAJECTORY_TABLE = "trajectories.bin";
+
+#if defined(__APPLE__)
+const char* const ENGINE_PATH = "../bin/stockfish-macos";
+#else
+const char* const ENGINE_PATH = "../bin/stockfish";
+#endif
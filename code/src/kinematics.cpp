@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cmath>
+#include "kinematics.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define IK_HAVE_AVX2 1
+#endif
+
+const float IK_EPS = 1e-6f;
+const float HALF_PI = 1.57079632679f;
+const float PI = 3.14159265359f;
+
+// minimax atan on [0, 1], odd terms in a
+const float ATAN_C[6] = {0.99997726f, -0.33262347f, 0.19354346f, -0.11643287f, 0.05265332f, -0.01172120f};
+
+int16_t EncoderCounts(double theta)
+{
+    long c = std::lround(theta * ENCODER_COUNTS / 6.283185307179586) % ENCODER_COUNTS;
+    if (c < -ENCODER_COUNTS / 2) c += ENCODER_COUNTS;
+    if (c >= ENCODER_COUNTS / 2) c -= ENCODER_COUNTS;
+
+    return (int16_t)c;
+}
+
+double EncoderAngle(int counts)
+{
+    return counts * (6.283185307179586 / ENCODER_COUNTS);
+}
+
+IKSolution SolveIK(const FiveBar& g, float x, float y)
+{
+    IKSolution s = {};
+
+    // left arm, B rotated off A->C by the angle at A
+    float rx = x - g.ax;
+    float ry = y - g.ay;
+    float d2 = rx * rx + ry * ry;
+    float d = std::sqrt(d2);
+
+    // right arm, D rotated the other way off E->C
+    float qx = x - g.ex;
+    float qy = y - g.ey;
+    float e2 = qx * qx + qy * qy;
+    float e = std::sqrt(e2);
+
+    s.valid = d > IK_EPS && e > IK_EPS &&
+              d2 >= (g.l1 - g.l2) * (g.l1 - g.l2) && d2 <= (g.l1 + g.l2) * (g.l1 + g.l2) &&
+              e2 >= (g.l4 - g.l3) * (g.l4 - g.l3) && e2 <= (g.l4 + g.l3) * (g.l4 + g.l3);
+
+    if (!s.valid) return s;
+
+    float c1 = std::clamp((g.l1 * g.l1 + d2 - g.l2 * g.l2) / (2.0f * g.l1 * d), -1.0f, 1.0f);
+    float s1 = std::sqrt(1.0f - c1 * c1);
+    float ux = rx / d, uy = ry / d;
+
+    float bx = c1 * ux - s1 * uy;
+    float by = c1 * uy + s1 * ux;
+
+    float c2 = std::clamp((g.l4 * g.l4 + e2 - g.l3 * g.l3) / (2.0f * g.l4 * e), -1.0f, 1.0f);
+    float s2 = std::sqrt(1.0f - c2 * c2);
+    float vx = qx / e, vy = qy / e;
+
+    float dx = c2 * vx + s2 * vy;
+    float dy = c2 * vy - s2 * vx;
+
+    s.theta1 = std::atan2(by, bx);
+    s.theta2 = std::atan2(dy, dx);
+    s.bx = g.ax + g.l1 * bx;
+    s.by = g.ay + g.l1 * by;
+    s.dx = g.ex + g.l4 * dx;
+    s.dy = g.ey + g.l4 * dy;
+
+    return s;
+}
+
+bool SolveIKPrecise(const FiveBar& g, double x, double y, double& theta1, double& theta2)
+{
+    double rx = x - g.ax, ry = y - g.ay;
+    double qx = x - g.ex, qy = y - g.ey;
+    double d = std::sqrt(rx * rx + ry * ry);
+    double e = std::sqrt(qx * qx + qy * qy);
+
+    if (d < IK_EPS || e < IK_EPS || d > g.l1 + g.l2 || d < std::fabs(g.l1 - g.l2) ||
+        e > g.l4 + g.l3 || e < std::fabs(g.l4 - g.l3)) return false;
+
+    double c1 = std::clamp(((double)g.l1 * g.l1 + d * d - (double)g.l2 * g.l2) / (2.0 * g.l1 * d), -1.0, 1.0);
+    double c2 = std::clamp(((double)g.l4 * g.l4 + e * e - (double)g.l3 * g.l3) / (2.0 * g.l4 * e), -1.0, 1.0);
+    double s1 = std::sqrt(1.0 - c1 * c1);
+    double s2 = std::sqrt(1.0 - c2 * c2);
+
+    theta1 = std::atan2(c1 * ry + s1 * rx, c1 * rx - s1 * ry);
+    theta2 = std::atan2(c2 * qy - s2 * qx, c2 * qx + s2 * qy);
+
+    return true;
+}
+
+bool SolveFK(const FiveBar& g, float theta1, float theta2, float& x, float& y)
+{
+    float bx = g.ax + g.l1 * std::cos(theta1), by = g.ay + g.l1 * std::sin(theta1);
+    float dx = g.ex + g.l4 * std::cos(theta2), dy = g.ey + g.l4 * std::sin(theta2);
+
+    float ux = dx - bx, uy = dy - by;
+    float d2 = ux * ux + uy * uy;
+    float d = std::sqrt(d2);
+
+    if (d < IK_EPS || d > g.l2 + g.l3 || d < std::fabs(g.l2 - g.l3)) return false;
+
+    // foot of C on B->D, then either way along the normal
+    float a = (g.l2 * g.l2 - g.l3 * g.l3 + d2) / (2.0f * d);
+    float h = std::sqrt(std::max(g.l2 * g.l2 - a * a, 0.0f));
+
+    float mx = bx + a * ux / d, my = by + a * uy / d;
+    float nx = -h * uy / d, ny = h * ux / d;
+
+    // the two assemblies are mirror images across B-D and the elbows-out
+    // angles alone do not tell them apart, so stay on the side of the hint
+    float ep = (mx + nx - x) * (mx + nx - x) + (my + ny - y) * (my + ny - y);
+    float em = (mx - nx - x) * (mx - nx - x) + (my - ny - y) * (my - ny - y);
+    bool plus = ep <= em;
+
+    x = plus ? mx + nx : mx - nx;
+    y = plus ? my + ny : my - ny;
+
+    return true;
+}
+
+// J up to the 1 / (u x v) that cancels out of the condition number, so it
+// stays finite right up to the forward singularity
+struct ScaledJacobian
+{
+    float j11, j12, j21, j22;
+    float cross;
+};
+
+static inline ScaledJacobian Scaled(const FiveBar& g, float theta1, float theta2, float x, float y)
+{
+    float c1 = std::cos(theta1), s1 = std::sin(theta1);
+    float c2 = std::cos(theta2), s2 = std::sin(theta2);
+
+    float ux = x - (g.ax + g.l1 * c1), uy = y - (g.ay + g.l1 * s1);
+    float vx = x - (g.ex + g.l4 * c2), vy = y - (g.ey + g.l4 * s2);
+
+    float a = g.l1 * (uy * c1 - ux * s1);
+    float b = g.l4 * (vy * c2 - vx * s2);
+
+    return {vy * a, -uy * b, -vx * a, ux * b, ux * vy - uy * vx};
+}
+
+// sigma max / sigma min of a 2x2 from its frobenius norm and determinant
+static inline float Condition(const ScaledJacobian& j)
+{
+    float f = j.j11 * j.j11 + j.j12 * j.j12 + j.j21 * j.j21 + j.j22 * j.j22;
+    float d = std::fabs(j.j11 * j.j22 - j.j12 * j.j21);
+    float r = std::sqrt(std::max(f * f - 4.0f * d * d, 0.0f));
+
+    return std::min((f + r) / std::max(2.0f * d, 1e-30f), CONDITION_LIMIT);
+}
+
+Jacobian SolveJacobian(const FiveBar& g, float theta1, float theta2, float x, float y)
+{
+    ScaledJacobian j = Scaled(g, theta1, theta2, x, y);
+    Jacobian out = {};
+
+    out.condition = Condition(j);
+    out.valid = std::fabs(j.cross) > IK_EPS;
+
+    if (!out.valid) return out;
+
+    out.j11 = j.j11 / j.cross;
+    out.j12 = j.j12 / j.cross;
+    out.j21 = j.j21 / j.cross;
+    out.j22 = j.j22 / j.cross;
+
+    return out;
+}
+
+void ConditionBatch(const FiveBar& g, const float* theta1, const float* theta2, const float* x, const float* y, int n,
+                    float* condition)
+{
+    for (int i = 0; i < n; i++) condition[i] = Condition(Scaled(g, theta1[i], theta2[i], x[i], y[i]));
+}
+
+// by value so the loop below stays free of branches
+static inline float Min(float a, float b) { return a < b ? a : b; }
+static inline float Max(float a, float b) { return a > b ? a : b; }
+
+static inline float FastAtan2(float y, float x)
+{
+    float ax = std::fabs(x), ay = std::fabs(y);
+    float a = Min(ax, ay) / Max(Max(ax, ay), IK_EPS);
+    float s = a * a;
+
+    float p = ATAN_C[5];
+    for (int i = 4; i >= 0; i--) p = p * s + ATAN_C[i];
+
+    float r = a * p;
+    r = ay > ax ? HALF_PI - r : r;
+    r = x < 0.0f ? PI - r : r;
+
+    return std::copysign(r, y);
+}
+
+// the same steps as SolveIK with selects instead of early outs so the
+// compiler can vectorise it where there is no hand written path
+static void SolveIKScalar(const FiveBar& g, const float* __restrict x, const float* __restrict y, int n,
+                          float* __restrict theta1, float* __restrict theta2, uint8_t* __restrict valid)
+{
+    float ax = g.ax, ay = g.ay, ex = g.ex, ey = g.ey;
+    float h1 = 0.5f / g.l1, h2 = 0.5f / g.l4;
+    float in1 = (g.l1 - g.l2) * (g.l1 - g.l2), out1 = (g.l1 + g.l2) * (g.l1 + g.l2);
+    float in2 = (g.l4 - g.l3) * (g.l4 - g.l3), out2 = (g.l4 + g.l3) * (g.l4 + g.l3);
+    float k1 = g.l1 * g.l1 - g.l2 * g.l2, k2 = g.l4 * g.l4 - g.l3 * g.l3;
+
+    for (int i = 0; i < n; i++)
+    {
+        float rx = x[i] - ax, ry = y[i] - ay;
+        float qx = x[i] - ex, qy = y[i] - ey;
+        float d2 = rx * rx + ry * ry;
+        float e2 = qx * qx + qy * qy;
+
+        float id = 1.0f / std::sqrt(Max(d2, IK_EPS));
+        float ie = 1.0f / std::sqrt(Max(e2, IK_EPS));
+
+        float c1 = Max(Min((k1 + d2) * id * h1, 1.0f), -1.0f);
+        float c2 = Max(Min((k2 + e2) * ie * h2, 1.0f), -1.0f);
+        float s1 = std::sqrt(1.0f - c1 * c1);
+        float s2 = std::sqrt(1.0f - c2 * c2);
+
+        theta1[i] = FastAtan2(c1 * ry + s1 * rx, c1 * rx - s1 * ry);
+        theta2[i] = FastAtan2(c2 * qy - s2 * qx, c2 * qx + s2 * qy);
+        valid[i] = (d2 >= in1) & (d2 <= out1) & (e2 >= in2) & (e2 <= out2) & (d2 > IK_EPS) & (e2 > IK_EPS);
+    }
+}
+
+#ifdef IK_HAVE_AVX2
+
+__attribute__((target("avx2,fma")))
+static inline __m256 Atan2Avx(__m256 y, __m256 x)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    __m256 ax = _mm256_andnot_ps(sign, x);
+    __m256 ay = _mm256_andnot_ps(sign, y);
+    __m256 a = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(IK_EPS)));
+    __m256 s = _mm256_mul_ps(a, a);
+
+    __m256 p = _mm256_set1_ps(ATAN_C[5]);
+    for (int i = 4; i >= 0; i--) p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C[i]));
+
+    __m256 r = _mm256_mul_ps(a, p);
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(HALF_PI), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PI), r), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+    return _mm256_or_ps(r, _mm256_and_ps(y, sign));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 ClampUnit(__m256 v)
+{
+    return _mm256_max_ps(_mm256_min_ps(v, _mm256_set1_ps(1.0f)), _mm256_set1_ps(-1.0f));
+}
+
+__attribute__((target("avx2,fma")))
+static int SolveIKAvx2(const FiveBar& g, const float* x, const float* y, int n,
+                       float* theta1, float* theta2, uint8_t* valid)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 eps = _mm256_set1_ps(IK_EPS);
+    const __m256 ax = _mm256_set1_ps(g.ax), ay = _mm256_set1_ps(g.ay);
+    const __m256 ex = _mm256_set1_ps(g.ex), ey = _mm256_set1_ps(g.ey);
+    const __m256 in1 = _mm256_set1_ps((g.l1 - g.l2) * (g.l1 - g.l2));
+    const __m256 out1 = _mm256_set1_ps((g.l1 + g.l2) * (g.l1 + g.l2));
+    const __m256 in2 = _mm256_set1_ps((g.l4 - g.l3) * (g.l4 - g.l3));
+    const __m256 out2 = _mm256_set1_ps((g.l4 + g.l3) * (g.l4 + g.l3));
+    const __m256 k1 = _mm256_set1_ps(g.l1 * g.l1 - g.l2 * g.l2);
+    const __m256 k2 = _mm256_set1_ps(g.l4 * g.l4 - g.l3 * g.l3);
+    const __m256 h1 = _mm256_set1_ps(0.5f / g.l1);
+    const __m256 h2 = _mm256_set1_ps(0.5f / g.l4);
+
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+
+        __m256 rx = _mm256_sub_ps(px, ax), ry = _mm256_sub_ps(py, ay);
+        __m256 qx = _mm256_sub_ps(px, ex), qy = _mm256_sub_ps(py, ey);
+        __m256 d2 = _mm256_fmadd_ps(rx, rx, _mm256_mul_ps(ry, ry));
+        __m256 e2 = _mm256_fmadd_ps(qx, qx, _mm256_mul_ps(qy, qy));
+
+        __m256 id = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(d2, eps)));
+        __m256 ie = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(e2, eps)));
+
+        __m256 c1 = ClampUnit(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(k1, d2), id), h1));
+        __m256 c2 = ClampUnit(_mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(k2, e2), ie), h2));
+        __m256 s1 = _mm256_sqrt_ps(_mm256_fnmadd_ps(c1, c1, one));
+        __m256 s2 = _mm256_sqrt_ps(_mm256_fnmadd_ps(c2, c2, one));
+
+        __m256 t1 = Atan2Avx(_mm256_fmadd_ps(c1, ry, _mm256_mul_ps(s1, rx)), _mm256_fmsub_ps(c1, rx, _mm256_mul_ps(s1, ry)));
+        __m256 t2 = Atan2Avx(_mm256_fmsub_ps(c2, qy, _mm256_mul_ps(s2, qx)), _mm256_fmadd_ps(c2, qx, _mm256_mul_ps(s2, qy)));
+
+        _mm256_storeu_ps(theta1 + i, t1);
+        _mm256_storeu_ps(theta2 + i, t2);
+
+        __m256 ok = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(d2, in1, _CMP_GE_OQ), _mm256_cmp_ps(d2, out1, _CMP_LE_OQ)),
+                                  _mm256_and_ps(_mm256_cmp_ps(e2, in2, _CMP_GE_OQ), _mm256_cmp_ps(e2, out2, _CMP_LE_OQ)));
+        ok = _mm256_and_ps(ok, _mm256_and_ps(_mm256_cmp_ps(d2, eps, _CMP_GT_OQ), _mm256_cmp_ps(e2, eps, _CMP_GT_OQ)));
+
+        int mask = _mm256_movemask_ps(ok);
+        for (int j = 0; j < 8; j++) valid[i + j] = (mask >> j) & 1;
+    }
+
+    return i;
+}
+
+static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+#else
+
+static const bool hasAvx2 = false;
+
+#endif
+
+void SolveIKBatch(const FiveBar& g, const float* x, const float* y, int n,
+                  float* theta1, float* theta2, uint8_t* valid)
+{
+    int done = 0;
+
+#ifdef IK_HAVE_AVX2
+    if (hasAvx2) done = SolveIKAvx2(g, x, y, n, theta1, theta2, valid);
+#endif
+
+    SolveIKScalar(g, x + done, y + done, n - done, theta1 + done, theta2 + done, valid + done);
+}
+
+const char* IKBatchPath()
+{
+    return hasAvx2 ? "avx2" : "scalar";
+}
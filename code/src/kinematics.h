@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+// the motors carry 14 bit absolute encoders, joint angles that are stored
+// or sent are counts of them
+const int ENCODER_COUNTS = 16384;
+
+// theta in counts wrapped to +-half a turn, and back to radians
+int16_t EncoderCounts(double theta);
+double EncoderAngle(int counts);
+
+// five bar geometry: motors at A (left) and E (right), proximal links
+// L1 (A-B) and L4 (E-D), distal links L2 (B-C) and L3 (D-C) meeting at
+// the end effector C. y points up, angles are radians from +x
+struct FiveBar
+{
+    float ax, ay;
+    float ex, ey;
+    float l1, l2, l3, l4;
+};
+
+struct IKSolution
+{
+    float theta1;   // A-B against +x
+    float theta2;   // E-D against +x
+    float bx, by;
+    float dx, dy;
+    bool valid;     // false when C is outside either annulus
+};
+
+// closed form, elbows out: B left of A->C, D right of E->C. only the two
+// joint angles need an atan2, B and D come from the law of cosines directly
+IKSolution SolveIK(const FiveBar& g, float x, float y);
+
+// the same solution in double, for planners that differentiate the angles
+// along a path and would otherwise amplify float rounding. false when out of reach
+bool SolveIKPrecise(const FiveBar& g, double x, double y, double& theta1, double& theta2);
+
+// end effector from the motor angles. x, y come in as a hint, usually the
+// last known position, and the assembly closest to it is returned. false
+// when the elbows are too far apart to close the loop
+bool SolveFK(const FiveBar& g, float theta1, float theta2, float& x, float& y);
+
+// past this the pose is treated as singular
+const float CONDITION_LIMIT = 1e4f;
+
+// dC/dtheta, board units per radian, column j for motor j. the loop
+// closure gives [C-B; C-D] dC = diag(L1 w1, L4 w2) dtheta, w the rate a
+// motor pushes its elbow across the distal link. condition is the ratio
+// of the largest to the smallest singular value, 1 when C moves alike in
+// every direction, and runs to CONDITION_LIMIT where the distal links line
+// up (C moves with the motors held) or one folds onto its proximal link
+// (a motor turns without moving C). x, y is C, as from SolveFK
+struct Jacobian
+{
+    float j11, j12;
+    float j21, j22;
+    float condition;
+    bool valid;   // false at a forward singularity, where J does not exist
+};
+
+Jacobian SolveJacobian(const FiveBar& g, float theta1, float theta2, float x, float y);
+
+// condition numbers only, structure of arrays over n poses
+void ConditionBatch(const FiveBar& g, const float* theta1, const float* theta2, const float* x, const float* y, int n,
+                    float* condition);
+
+// structure of arrays batch over n targets, theta and valid are written
+// for every i. uses AVX2 when the cpu has it and a branch free scalar loop
+// otherwise; both share a polynomial atan2 good to about 1e-5 rad
+void SolveIKBatch(const FiveBar& g, const float* x, const float* y, int n,
+                  float* theta1, float* theta2, uint8_t* valid);
+
+// the path the batch call takes on this machine, "avx2" or "scalar"
+const char* IKBatchPath();
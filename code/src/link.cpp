@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "link.h"
+
+ControllerLink controller;
+
+using Clock = std::chrono::steady_clock;
+
+// the reset is repeated until the controller answers it
+const auto RESET_RETRY = std::chrono::milliseconds(100);
+
+// with frames out and no credit for this long past the time they take on
+// the wire, go back and send them again
+const auto RESEND_AFTER = std::chrono::milliseconds(50);
+
+// a nak only goes back once the last go back has had time to arrive, the
+// controller sends one for every stray frame that was already on its way
+const auto NAK_HOLDOFF = std::chrono::milliseconds(20);
+
+// frames out at once, under half the sequence space so acks are unambiguous
+const size_t WINDOW_FRAMES = 64;
+
+static bool BaudSpeed(int baud, speed_t& speed)
+{
+    switch (baud)
+    {
+    case 9600: speed = B9600; return true;
+    case 19200: speed = B19200; return true;
+    case 38400: speed = B38400; return true;
+    case 57600: speed = B57600; return true;
+    case 115200: speed = B115200; return true;
+    case 230400: speed = B230400; return true;
+#ifdef B460800
+    case 460800: speed = B460800; return true;
+#endif
+#ifdef B921600
+    case 921600: speed = B921600; return true;
+#endif
+#ifdef B1000000
+    case 1000000: speed = B1000000; return true;
+#endif
+#ifdef B2000000
+    case 2000000: speed = B2000000; return true;
+#endif
+    default: return false;
+    }
+}
+
+bool ControllerLink::open(const std::string& device, int baud)
+{
+    speed_t speed;
+    if (connected() || !BaudSpeed(baud, speed)) return false;
+
+    fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    termios t;
+    if (tcgetattr(fd, &t) != 0)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    cfmakeraw(&t);
+    cfsetispeed(&t, speed);
+    cfsetospeed(&t, speed);
+    t.c_cflag |= CLOCAL | CREAD;
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 0;
+
+    if (tcsetattr(fd, TCSANOW, &t) != 0)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    tcflush(fd, TCIOFLUSH);
+
+    this->baud = baud;
+    parser = {};
+    unacked.clear();
+    out.clear();
+    nextSeq = 0;
+    synced = false;
+    slots = 0;
+    inFlight = 0;
+    lastUnderruns = 0;
+    lastReset = Clock::time_point{};
+
+    quit = false;
+    worker = std::thread(&ControllerLink::run, this);
+
+    return true;
+}
+
+void ControllerLink::close()
+{
+    if (!connected()) return;
+
+    quit = true;
+    if (worker.joinable()) worker.join();
+
+    ::close(fd);
+    fd = -1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.clear();
+    counters = {};
+    queued = 0;
+}
+
+void ControllerLink::send(const Trajectory& traj)
+{
+    if (traj.setpoints.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < traj.setpoints.size(); i++)
+    {
+        const JointSetpoint& sp = traj.setpoints[i];
+        pending.push_back({{EncoderCounts(sp.theta1), EncoderCounts(sp.theta2)}, i + 1 == traj.setpoints.size()});
+    }
+
+    queued += traj.setpoints.size();
+}
+
+bool ControllerLink::flush(int timeoutMs)
+{
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (Clock::now() < deadline)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (counters.setpoints == queued) return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+}
+
+LinkStats ControllerLink::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void ControllerLink::acknowledge(uint8_t ack)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // everything up to ack, in sequence space
+    while (!unacked.empty() && (uint8_t)(ack - unacked.front().seq) < 128)
+    {
+        inFlight -= unacked.front().count;
+        counters.setpoints += unacked.front().count;
+        unacked.pop_front();
+        lastProgress = Clock::now();
+    }
+}
+
+Clock::duration ControllerLink::wireTime() const
+{
+    size_t bytes = 0;
+    for (const Sent& s : unacked) bytes += s.bytes.size();
+
+    // 10 bits a byte with start and stop bits
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bytes * 10.0 / baud));
+}
+
+void ControllerLink::resend(Clock::time_point now)
+{
+    for (const Sent& s : unacked) out.insert(out.end(), s.bytes.begin(), s.bytes.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.resent += unacked.size();
+    lastResend = lastProgress = now;
+}
+
+void ControllerLink::receive(const Frame& f, Clock::time_point now)
+{
+    CreditReport r;
+
+    if (DecodeCredit(f, r))
+    {
+        // the first credit after the reset acknowledges it
+        if (!synced)
+        {
+            synced = true;
+            nextSeq = 1;
+            lastUnderruns = r.underruns;
+        }
+
+        acknowledge(r.ack);
+        slots = r.free;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.depth = r.depth;
+        counters.crcErrors = parser.crcErrors();
+        counters.underruns += (uint16_t)(r.underruns - lastUnderruns);
+        lastUnderruns = r.underruns;
+
+        // more is owed than is on its way, so the queue should not be low
+        if (!pending.empty() && counters.setpoints) counters.minDepth = counters.minDepth < 0 ? r.depth : std::min(counters.minDepth, (int)r.depth);
+    }
+    else if (f.type == FRAME_NAK && synced)
+    {
+        acknowledge((uint8_t)(f.seq - 1));
+        if (now - lastResend > wireTime() + NAK_HOLDOFF) resend(now);
+    }
+}
+
+void ControllerLink::run()
+{
+    uint8_t buffer[512];
+    uint8_t frame[FRAME_OVERHEAD + FRAME_PAYLOAD_MAX];
+    WireSetpoint batch[BATCH_SETPOINTS];
+
+    while (!quit)
+    {
+        pollfd p = {fd, (short)(POLLIN | (out.empty() ? 0 : POLLOUT)), 0};
+        ::poll(&p, 1, 1);
+
+        auto now = Clock::now();
+
+        ssize_t n;
+        while ((n = ::read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t i = 0; i < n; i++)
+            {
+                if (parser.feed(buffer[i])) receive(parser.frame(), now);
+            }
+        }
+
+        if (!synced)
+        {
+            // nothing else goes out until the controller has emptied its queue
+            if (now - lastReset > RESET_RETRY)
+            {
+                size_t size = EncodeFrame(FRAME_RESET, 0, nullptr, 0, frame);
+                out.insert(out.end(), frame, frame + size);
+                lastReset = now;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // a full batch, or the rest of a trajectory, when the credits cover it
+            while (!pending.empty() && unacked.size() < WINDOW_FRAMES)
+            {
+                int count = 0;
+                bool end = false;
+
+                while (count < BATCH_SETPOINTS && count < (int)pending.size() && !end) end = pending[count++].last;
+
+                if (count > slots - inFlight) break;
+
+                for (int i = 0; i < count; i++) batch[i] = pending[i].setpoint;
+
+                size_t size = EncodeSetpoints(nextSeq, end ? SETPOINTS_END : 0, batch, count, frame);
+
+                if (unacked.empty()) lastProgress = now;
+                unacked.push_back({nextSeq, count, std::vector<uint8_t>(frame, frame + size)});
+                out.insert(out.end(), frame, frame + size);
+                pending.erase(pending.begin(), pending.begin() + count);
+
+                inFlight += count;
+                nextSeq++;
+                counters.frames++;
+            }
+        }
+
+        if (!unacked.empty() && now - lastProgress > wireTime() + RESEND_AFTER) resend(now);
+
+        if (!out.empty())
+        {
+            ssize_t w = ::write(fd, out.data(), out.size());
+            if (w > 0) out.erase(out.begin(), out.begin() + w);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "protocol.h"
+#include "trajectory.h"
+
+struct LinkStats
+{
+    uint64_t frames = 0;       // setpoint frames sent, counting each once
+    uint64_t resent = 0;       // sent again after a nak or a silence
+    uint64_t setpoints = 0;    // acknowledged by the controller
+    uint32_t crcErrors = 0;    // bad frames from the controller
+    int depth = 0;             // controller queue at the last credit
+    int minDepth = -1;         // lowest depth reported mid stream, -1 before any
+    uint32_t underruns = 0;    // ticks the controller ran dry mid trajectory
+};
+
+// streams joint setpoints to the motor controller over a serial device in
+// the frames of protocol.h, on a thread of its own so a slow frame or a
+// long plan on the caller's side does not starve the controller. setpoints
+// go out in full batches as the controller's credits allow
+class ControllerLink
+{
+public:
+    ~ControllerLink() { close(); }
+
+    // raw 8n1 at baud, false when the device or the rate is not there
+    bool open(const std::string& device, int baud);
+    void close();
+
+    bool connected() const { return fd >= 0; }
+
+    // queues every setpoint of traj, which runs at the controller's tick
+    void send(const Trajectory& traj);
+
+    // waits until the controller has taken everything sent, false on timeout
+    bool flush(int timeoutMs);
+
+    LinkStats stats() const;
+
+private:
+    struct Queued
+    {
+        WireSetpoint setpoint;
+        bool last;   // ends a trajectory
+    };
+
+    struct Sent
+    {
+        uint8_t seq;
+        int count;
+        std::vector<uint8_t> bytes;
+    };
+
+    void run();
+    void receive(const Frame& f, std::chrono::steady_clock::time_point now);
+    void acknowledge(uint8_t ack);
+    void resend(std::chrono::steady_clock::time_point now);
+
+    // how long the frames out take to send at the line rate
+    std::chrono::steady_clock::duration wireTime() const;
+
+    int fd = -1;
+    int baud = 0;
+    std::thread worker;
+    std::atomic<bool> quit{false};
+
+    mutable std::mutex mutex;
+    std::deque<Queued> pending;
+    uint64_t queued = 0;
+    LinkStats counters;
+
+    // sender thread only
+    FrameParser parser;
+    std::deque<Sent> unacked;
+    std::vector<uint8_t> out;
+    uint8_t nextSeq = 0;
+    bool synced = false;
+    int slots = 0;   // the controller's free setpoint slots at its last credit
+    int inFlight = 0;
+    uint16_t lastUnderruns = 0;
+    std::chrono::steady_clock::time_point lastReset, lastProgress, lastResend;
+};
+
+extern ControllerLink controller;
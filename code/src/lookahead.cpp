@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cmath>
+#include "lookahead.h"
+
+LookaheadPlanner::LookaheadPlanner(const FiveBar& g, const MotorLimits& limits, Vector2 start)
+    : geometry(g), limits(limits), end(start)
+{
+    double t1 = 0, t2 = 0;
+    SolveIKPrecise(g, start.x, start.y, t1, t2);
+
+    theta[0] = (float)t1;
+    theta[1] = (float)t2;
+}
+
+bool LookaheadPlanner::rates(Vector2 p, Vector2 dir, double q[2], double& spread) const
+{
+    double t1, t2;
+    if (!SolveIKPrecise(geometry, p.x, p.y, t1, t2)) return false;
+
+    Jacobian j = SolveJacobian(geometry, (float)t1, (float)t2, p.x, p.y);
+    double det = (double)j.j11 * j.j22 - (double)j.j12 * j.j21;
+    if (!j.valid || std::fabs(det) < 1e-9) return false;
+
+    // dtheta = J^-1 dC
+    q[0] = (j.j22 * dir.x - j.j12 * dir.y) / det;
+    q[1] = (-j.j21 * dir.x + j.j11 * dir.y) / det;
+
+    // the most either joint turns for a unit move in any direction, the
+    // rows of J^-1
+    spread = std::max(std::hypot(j.j22, j.j12), std::hypot(j.j21, j.j11)) / std::fabs(det);
+
+    return true;
+}
+
+bool LookaheadPlanner::append(Vector2 p, bool stop)
+{
+    if (full()) return false;
+
+    float dx = p.x - end.x, dy = p.y - end.y;
+    double length = std::hypot(dx, dy);
+
+    if (length < 1e-4)
+    {
+        stopNext = stopNext || stop;
+        return true;
+    }
+
+    // joint rates per unit of path at the ends and the middle. the joints
+    // curve even along a straight line, so at speed v they need q' v^2 of
+    // acceleration before any goes to speeding up: half the limit is kept
+    // for that, half for the trapezoid
+    Vector2 dir = {(float)(dx / length), (float)(dy / length)};
+    double q[3][2], spread[3];
+
+    for (int k = 0; k < 3; k++)
+    {
+        Vector2 at = {(float)(end.x + dx * 0.5 * k), (float)(end.y + dy * 0.5 * k)};
+        if (rates(at, dir, q[k], spread[k])) continue;
+
+        // a stop asked for there is made where the stream is instead
+        stopNext = stopNext || stop;
+        return false;
+    }
+
+    double worst = std::max({std::fabs(q[0][0]), std::fabs(q[0][1]), std::fabs(q[1][0]), std::fabs(q[1][1]),
+                             std::fabs(q[2][0]), std::fabs(q[2][1]), 1e-9});
+    double bend = 0;
+
+    for (int j = 0; j < 2; j++)
+        bend = std::max({bend, std::fabs(q[1][j] - q[0][j]), std::fabs(q[2][j] - q[1][j])});
+
+    bend /= 0.5 * length;
+
+    Block b = {};
+    b.from = end;
+    b.dir = dir;
+    b.length = length;
+
+    double budget = 0.5 * limits.acceleration;
+
+    b.speed = limits.velocity / worst;
+    if (bend > 0) b.speed = std::min(b.speed, std::sqrt(budget / bend));
+    b.accel = budget / worst;
+
+    // turning at a corner pulls across the segments, not along them
+    b.turnAccel = budget / std::max(spread[0], 1e-9);
+
+    // junction deviation: the arc of deviation d inside a corner of angle
+    // theta has radius d sin(theta/2) / (1 - sin(theta/2)), taken at the
+    // acceleration across the corner. a curve cut into short segments
+    // turns a little at each and that radius grows without bound, so it is
+    // also held to the curve's own, segment length over the turn
+    b.maxEntry = 0;
+
+    if (count && !stopNext)
+    {
+        const Block& last = at(tail + count - 1);
+        double c = -(last.dir.x * b.dir.x + last.dir.y * b.dir.y);
+
+        if (c < -0.999999) b.maxEntry = std::min(last.speed, b.speed);
+        else if (c < 0.999999)
+        {
+            double sine = std::sqrt(0.5 * (1.0 - c));
+            double radius = JUNCTION_DEVIATION * sine / (1.0 - sine);
+            double turn = 3.141592653589793 - std::acos(c);
+            radius = std::min(radius, std::min(last.length, b.length) / turn);
+
+            b.maxEntry = std::min({last.speed, b.speed, std::sqrt(b.turnAccel * radius)});
+        }
+    }
+
+    at(tail + count) = b;
+    count++;
+
+    end = p;
+    stopNext = stop;
+
+    replan();
+
+    return true;
+}
+
+void LookaheadPlanner::replan()
+{
+    // the block being played keeps its entry speed
+    planned = std::max(planned, tail + 1);
+
+    uint64_t newest = tail + count - 1;
+    if (planned > newest) return;
+
+    // backward: the newest block has to be able to stop at its end, and
+    // each before it to slow to the entry of the one after
+    double exit = 0;
+
+    for (uint64_t n = newest; n >= planned; n--)
+    {
+        Block& b = at(n);
+        b.entry = std::min(b.maxEntry, std::sqrt(exit * exit + 2 * b.accel * b.length));
+        exit = b.entry;
+        visits++;
+
+        if (n == planned) break;
+    }
+
+    // forward: a block's exit is capped by how fast it can get there from
+    // its entry. a block that accelerates flat out, or enters at its
+    // junction limit, is final and the next pass can start past it
+    for (uint64_t n = planned - 1; n < newest; n++)
+    {
+        Block& b = at(n);
+        Block& after = at(n + 1);
+        visits++;
+
+        double reach = std::sqrt(b.entry * b.entry + 2 * b.accel * b.length);
+
+        if (reach <= after.entry)
+        {
+            after.entry = reach;
+            planned = n + 2;
+        }
+        else if (after.entry >= after.maxEntry) planned = n + 2;
+    }
+}
+
+bool LookaheadPlanner::next(double dt, JointSetpoint& out)
+{
+    if (!count) return false;
+
+    double remaining = dt;
+    Vector2 p = end;
+    Vector2 dir = {0, 0};
+
+    while (remaining > 1e-12 && count)
+    {
+        Block& b = at(tail);
+        double exit = count > 1 ? at(tail + 1).entry : 0.0;
+        double left = b.length - s;
+
+        // as fast as the block allows, under the braking curve to its exit
+        double brake = std::sqrt(std::max(0.0, exit * exit + 2 * b.accel * (left - v * remaining)));
+        double faster = std::min(b.speed, v + b.accel * remaining);
+        double after = std::max(0.0, std::min(faster, brake));
+        double ds = 0.5 * (v + after) * remaining;
+
+        if (ds >= left)
+        {
+            // the rest of the tick goes to the next block
+            remaining -= ds > 0 ? remaining * left / ds : remaining;
+            v = std::min(after, exit);
+            s = 0;
+
+            tail++;
+            count--;
+            continue;
+        }
+
+        s += ds;
+        v = after;
+        remaining = 0;
+
+        p = {(float)(b.from.x + b.dir.x * s), (float)(b.from.y + b.dir.y * s)};
+        dir = b.dir;
+    }
+
+    time += dt;
+
+    double t1, t2;
+    if (SolveIKPrecise(geometry, p.x, p.y, t1, t2))
+    {
+        theta[0] = theta[0] + (float)std::remainder(t1 - theta[0], 6.283185307179586);
+        theta[1] = theta[1] + (float)std::remainder(t2 - theta[1], 6.283185307179586);
+    }
+
+    double q[2] = {0, 0}, spread;
+    if (!count || !rates(p, dir, q, spread)) q[0] = q[1] = 0;
+
+    out.t = (float)time;
+    out.theta1 = theta[0];
+    out.theta2 = theta[1];
+    out.omega1 = (float)(q[0] * v);
+    out.omega2 = (float)(q[1] * v);
+    out.x = p.x;
+    out.y = p.y;
+
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <raylib.h>
+#include "kinematics.h"
+#include "trajectory.h"
+
+// straight segments queued ahead of the arm, most a planner looks over
+const int LOOKAHEAD_BLOCKS = 64;
+
+// how far the arm may cut a corner, board units. the junction speed is
+// the one that keeps the end effector on an arc this far inside the
+// corner inside its acceleration limit
+const float JUNCTION_DEVIATION = 1.0f;
+
+// plans a stream of straight segments the way a cnc controller plans
+// g-code: each segment's speed and acceleration are the joint limits
+// mapped through the jacobian along it, a corner is taken at the speed
+// its angle allows instead of stopping, and a ring of upcoming segments
+// is kept so the arm only has to be able to stop at the end of what has
+// been queued so far. appending runs the backward pass from the new
+// segment and the forward pass from the first segment whose entry speed
+// can still rise, so the work is bounded by the ring, not the stream.
+// the profile is trapezoidal in path speed, jerk is not bounded
+class LookaheadPlanner
+{
+public:
+    LookaheadPlanner(const FiveBar& g, const MotorLimits& limits, Vector2 start);
+
+    // queues the segment from the end of the last one to p. false when
+    // the ring is full and next() has to play some of it first, or when
+    // the segment leaves the arm's reach. that one is not queued, the
+    // stream stays where it was and a stop is made there instead;
+    // full() tells the two apart. stop brings the arm to rest at p, as
+    // for the magnet
+    bool append(Vector2 p, bool stop = false);
+
+    // one control tick of motion, false once everything queued is played
+    bool next(double dt, JointSetpoint& out);
+
+    int queued() const { return count; }
+    bool full() const { return count == LOOKAHEAD_BLOCKS; }
+
+    // blocks the passes have visited, for the bench
+    uint64_t replanned() const { return visits; }
+
+private:
+    struct Block
+    {
+        Vector2 from;
+        Vector2 dir;        // unit
+        double length;
+        double speed;       // nominal, board units a second
+        double accel;
+        double turnAccel;   // at the start, in the direction the joints are weakest
+        double maxEntry;    // junction limit with the block before
+        double entry;
+    };
+
+    Block& at(uint64_t n) { return ring[n % LOOKAHEAD_BLOCKS]; }
+
+    // joint rates per unit of path along dir at p, and the largest in any
+    // direction, false out of reach
+    bool rates(Vector2 p, Vector2 dir, double q[2], double& spread) const;
+    void replan();
+
+    FiveBar geometry;
+    MotorLimits limits;
+
+    Block ring[LOOKAHEAD_BLOCKS];
+    uint64_t tail = 0;      // block being played
+    uint64_t planned = 0;   // blocks before this have their final entry speed
+    int count = 0;
+
+    Vector2 end;            // where the last queued segment ends
+    bool stopNext = false;
+
+    double s = 0;           // along the block being played
+    double v = 0;
+    double time = 0;
+    float theta[2] = {};
+
+    uint64_t visits = 0;
+};
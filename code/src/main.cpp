@@ -1,10 +1,12 @@
 #include <raylib.h>
 #include "bar.h"
 #include "chess.h"
+#include "link.h"
 #include "stockfish.h"
+#include "table.h"
 #include "config.h"
 
-int main(void)
+int main(int argc, char** argv)
 {
     SetConfigFlags(
         FLAG_VSYNC_HINT |
@@ -14,7 +16,17 @@ int main(void)
     InitWindow(WIDTH, HEIGHT, "5-Bar Mechanism Simulation");
     SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
 
-    sf.start("../bin/stockfish-macos");
+    InitBar();
+
+    if (!trajectoryTable.open(TRAJECTORY_TABLE, ARM_GEOMETRY, MOTOR_LIMITS, 1.0 / CONTROL_HZ))
+        TraceLog(LOG_INFO, "no trajectory table at %s, every move is planned", TRAJECTORY_TABLE);
+
+    const char* enginePath = argc > 1 ? argv[1] : ENGINE_PATH;
+    if (!sf.start(enginePath)) TraceLog(LOG_WARNING, "failed to start engine: %s", enginePath);
+
+    // the motor controller, when there is one, is the second argument
+    if (argc > 2 && !controller.open(argv[2], CONTROLLER_BAUD))
+        TraceLog(LOG_WARNING, "failed to open controller: %s", argv[2]);
 
     while (!WindowShouldClose())
     {
@@ -30,6 +42,7 @@ int main(void)
         EndDrawing();
     }
 
+    controller.close();
     sf.stop();
     CloseWindow();
     return 0;
@@ -0,0 +1,433 @@
+#include "movegen.h"
+
+static const struct StepTables
+{
+    Bitboard knight[64];
+    Bitboard king[64];
+    Bitboard pawn[2][64];
+
+    StepTables()
+    {
+        const int knightSteps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+        const int kingSteps[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+
+        for (int sq = 0; sq < 64; sq++)
+        {
+            int f = SquareFile(sq), r = SquareRank(sq);
+
+            auto bit = [&](int df, int dr) -> Bitboard
+            {
+                int nf = f + df, nr = r + dr;
+                return (nf >= 0 && nf < 8 && nr >= 0 && nr < 8) ? SquareBit(MakeSquare(nf, nr)) : 0;
+            };
+
+            knight[sq] = king[sq] = 0;
+            for (auto& s : knightSteps) knight[sq] |= bit(s[0], s[1]);
+            for (auto& s : kingSteps) king[sq] |= bit(s[0], s[1]);
+
+            pawn[SIDE_WHITE][sq] = bit(-1, 1) | bit(1, 1);
+            pawn[SIDE_BLACK][sq] = bit(-1, -1) | bit(1, -1);
+        }
+    }
+} steps;
+
+static Bitboard SlideAttacks(int sq, Bitboard occupied, const int dirs[4][2])
+{
+    Bitboard attacks = 0;
+
+    for (int d = 0; d < 4; d++)
+    {
+        int f = SquareFile(sq) + dirs[d][0];
+        int r = SquareRank(sq) + dirs[d][1];
+
+        while (f >= 0 && f < 8 && r >= 0 && r < 8)
+        {
+            Bitboard b = SquareBit(MakeSquare(f, r));
+            attacks |= b;
+            if (occupied & b) break;
+
+            f += dirs[d][0];
+            r += dirs[d][1];
+        }
+    }
+
+    return attacks;
+}
+
+static const int BISHOP_DIRS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const int ROOK_DIRS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+struct Magic
+{
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    int shift;
+
+    unsigned index(Bitboard occupied) const { return (unsigned)(((occupied & mask) * magic) >> shift); }
+};
+
+// fancy magic bitboards, magics are searched once at startup with a fixed seed
+static struct MagicTables
+{
+    Magic bishop[64];
+    Magic rook[64];
+    Bitboard bishopTable[0x1480];
+    Bitboard rookTable[0x19000];
+
+    Bitboard between[64][64];
+    Bitboard line[64][64];
+
+    MagicTables()
+    {
+        init(bishop, bishopTable, BISHOP_DIRS);
+        init(rook, rookTable, ROOK_DIRS);
+
+        for (int a = 0; a < 64; a++)
+        {
+            for (int b = 0; b < 64; b++)
+            {
+                between[a][b] = line[a][b] = 0;
+                if (a == b) continue;
+
+                const int (*dirs)[2] = nullptr;
+
+                if (SlideAttacks(a, 0, BISHOP_DIRS) & SquareBit(b)) dirs = BISHOP_DIRS;
+                else if (SlideAttacks(a, 0, ROOK_DIRS) & SquareBit(b)) dirs = ROOK_DIRS;
+                else continue;
+
+                line[a][b] = (SlideAttacks(a, 0, dirs) & SlideAttacks(b, 0, dirs)) | SquareBit(a) | SquareBit(b);
+                between[a][b] = SlideAttacks(a, SquareBit(b), dirs) & SlideAttacks(b, SquareBit(a), dirs);
+            }
+        }
+    }
+
+    static void init(Magic* magics, Bitboard* table, const int dirs[4][2])
+    {
+        uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+        auto random = [&]
+        {
+            seed ^= seed >> 12;
+            seed ^= seed << 25;
+            seed ^= seed >> 27;
+            return seed * 0x2545F4914F6CDD1DULL;
+        };
+
+        Bitboard occupancy[4096], reference[4096];
+        int epoch[4096] = {};
+        int attempt = 0;
+
+        Bitboard* next = table;
+
+        for (int sq = 0; sq < 64; sq++)
+        {
+            Magic& m = magics[sq];
+
+            // edges never block, so they are left out of the mask
+            Bitboard edges = ((0xFFULL | 0xFF00000000000000ULL) & ~(0xFFULL << (SquareRank(sq) * 8))) |
+                             ((0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << SquareFile(sq)));
+
+            m.mask = SlideAttacks(sq, 0, dirs) & ~edges;
+            m.shift = 64 - PopCount(m.mask);
+            m.attacks = next;
+
+            // carry-rippler over every subset of the mask
+            int size = 0;
+            Bitboard b = 0;
+            do
+            {
+                occupancy[size] = b;
+                reference[size] = SlideAttacks(sq, b, dirs);
+                size++;
+                b = (b - m.mask) & m.mask;
+            } while (b);
+
+            next += size;
+
+            for (int i = 0; i < size;)
+            {
+                do m.magic = random() & random() & random();
+                while (PopCount((m.mask * m.magic) >> 56) < 6);
+
+                attempt++;
+
+                for (i = 0; i < size; i++)
+                {
+                    unsigned idx = m.index(occupancy[i]);
+
+                    if (epoch[idx] < attempt)
+                    {
+                        epoch[idx] = attempt;
+                        m.attacks[idx] = reference[i];
+                    }
+                    else if (m.attacks[idx] != reference[i]) break;
+                }
+            }
+        }
+    }
+} magics;
+
+Bitboard KnightAttacks(int sq) { return steps.knight[sq]; }
+Bitboard KingAttacks(int sq) { return steps.king[sq]; }
+Bitboard PawnAttacks(int color, int sq) { return steps.pawn[color][sq]; }
+
+Bitboard BishopAttacks(int sq, Bitboard occupied)
+{
+    const Magic& m = magics.bishop[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+Bitboard RookAttacks(int sq, Bitboard occupied)
+{
+    const Magic& m = magics.rook[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+Bitboard Between(int a, int b) { return magics.between[a][b]; }
+Bitboard Line(int a, int b) { return magics.line[a][b]; }
+
+bool IsAttacked(const Board& board, int sq, int byColor)
+{
+    Bitboard occ = board.occupancy();
+    Bitboard queens = board.piecesOf(byColor, QUEEN);
+
+    if (PawnAttacks(byColor ^ 1, sq) & board.piecesOf(byColor, PAWN)) return true;
+    if (KnightAttacks(sq) & board.piecesOf(byColor, KNIGHT)) return true;
+    if (KingAttacks(sq) & board.piecesOf(byColor, KING)) return true;
+    if (BishopAttacks(sq, occ) & (board.piecesOf(byColor, BISHOP) | queens)) return true;
+    if (RookAttacks(sq, occ) & (board.piecesOf(byColor, ROOK) | queens)) return true;
+
+    return false;
+}
+
+bool InCheck(const Board& board)
+{
+    int us = board.sideToMove();
+    return IsAttacked(board, board.kingSquare(us), us ^ 1);
+}
+
+static Bitboard AttackersTo(const Board& board, int sq, int byColor, Bitboard occ)
+{
+    Bitboard queens = board.piecesOf(byColor, QUEEN);
+
+    return (PawnAttacks(byColor ^ 1, sq) & board.piecesOf(byColor, PAWN)) |
+           (KnightAttacks(sq) & board.piecesOf(byColor, KNIGHT)) |
+           (KingAttacks(sq) & board.piecesOf(byColor, KING)) |
+           (BishopAttacks(sq, occ) & (board.piecesOf(byColor, BISHOP) | queens)) |
+           (RookAttacks(sq, occ) & (board.piecesOf(byColor, ROOK) | queens));
+}
+
+static void AddMoves(const Board& board, MoveList& list, int from, Bitboard targets)
+{
+    while (targets)
+    {
+        int to = PopLsb(targets);
+
+        Move m;
+        m.from = from;
+        m.to = to;
+        if (board.pieceOn(to) != NO_PIECE) m.flags = MOVE_CAPTURE;
+
+        list.push(m);
+    }
+}
+
+static void AddPawnMove(MoveList& list, int from, int to, uint8_t flags)
+{
+    Move m;
+    m.from = from;
+    m.to = to;
+    m.flags = flags;
+
+    if (SquareRank(to) == 0 || SquareRank(to) == 7)
+    {
+        for (int p = QUEEN; p >= KNIGHT; p--)
+        {
+            m.promotion = p;
+            list.push(m);
+        }
+    }
+    else list.push(m);
+}
+
+// en passant can expose the king along the rank through both pawns
+static bool EpIsLegal(const Board& board, int from, int ep)
+{
+    int us = board.sideToMove();
+    int them = us ^ 1;
+    int king = board.kingSquare(us);
+
+    Bitboard occ = (board.occupancy() ^ SquareBit(from) ^ SquareBit(ep ^ 8)) | SquareBit(ep);
+    Bitboard queens = board.piecesOf(them, QUEEN);
+
+    return !(BishopAttacks(king, occ) & (board.piecesOf(them, BISHOP) | queens)) &&
+           !(RookAttacks(king, occ) & (board.piecesOf(them, ROOK) | queens));
+}
+
+void GenerateLegal(const Board& board, MoveList& list)
+{
+    list.size = 0;
+
+    int us = board.sideToMove();
+    int them = us ^ 1;
+    int king = board.kingSquare(us);
+
+    Bitboard own = board.colorBits(us);
+    Bitboard enemy = board.colorBits(them);
+    Bitboard occ = board.occupancy();
+
+    Bitboard checkers = AttackersTo(board, king, them, occ);
+
+    // king moves, with the king lifted so it cannot hide behind itself
+    Bitboard kingTargets = KingAttacks(king) & ~own;
+    Bitboard noKing = occ ^ SquareBit(king);
+
+    while (kingTargets)
+    {
+        int to = PopLsb(kingTargets);
+        if (AttackersTo(board, to, them, noKing)) continue;
+
+        Move m;
+        m.from = king;
+        m.to = to;
+        if (enemy & SquareBit(to)) m.flags = MOVE_CAPTURE;
+
+        list.push(m);
+    }
+
+    if (PopCount(checkers) > 1) return;
+
+    Bitboard target = ~own;
+    if (checkers) target = checkers | Between(king, __builtin_ctzll(checkers));
+
+    // pinned pieces may only move along the pin line
+    Bitboard pinned = 0;
+    Bitboard queens = board.piecesOf(them, QUEEN);
+    Bitboard snipers = (RookAttacks(king, 0) & (board.piecesOf(them, ROOK) | queens)) |
+                       (BishopAttacks(king, 0) & (board.piecesOf(them, BISHOP) | queens));
+
+    while (snipers)
+    {
+        Bitboard blockers = Between(king, PopLsb(snipers)) & occ;
+        if (PopCount(blockers) == 1) pinned |= blockers & own;
+    }
+
+    auto allowed = [&](int from)
+    {
+        return (pinned & SquareBit(from)) ? target & Line(king, from) : target;
+    };
+
+    Bitboard b;
+
+    // pawns
+    int forward = us == SIDE_WHITE ? 8 : -8;
+    int startRank = us == SIDE_WHITE ? 1 : 6;
+    int ep = board.epSquare();
+
+    b = board.piecesOf(us, PAWN);
+    while (b)
+    {
+        int from = PopLsb(b);
+        int to = from + forward;
+        Bitboard ok = allowed(from);
+
+        if (!(occ & SquareBit(to)))
+        {
+            if (ok & SquareBit(to)) AddPawnMove(list, from, to, 0);
+
+            int two = to + forward;
+            if (SquareRank(from) == startRank && !(occ & SquareBit(two)) && (ok & SquareBit(two)))
+                AddPawnMove(list, from, two, MOVE_DOUBLE);
+        }
+
+        Bitboard caps = PawnAttacks(us, from) & enemy & ok;
+        while (caps) AddPawnMove(list, from, PopLsb(caps), MOVE_CAPTURE);
+
+        // the captured pawn may itself be the checker
+        if (ep >= 0 && (PawnAttacks(us, from) & SquareBit(ep)) &&
+            ((ok & SquareBit(ep)) || (checkers & SquareBit(ep ^ 8))) &&
+            (!(pinned & SquareBit(from)) || (Line(king, from) & SquareBit(ep))) &&
+            EpIsLegal(board, from, ep))
+            AddPawnMove(list, from, ep, MOVE_CAPTURE | MOVE_EP);
+    }
+
+    b = board.piecesOf(us, KNIGHT) & ~pinned;
+    while (b) { int from = PopLsb(b); AddMoves(board, list, from, KnightAttacks(from) & target); }
+
+    b = board.piecesOf(us, BISHOP) | board.piecesOf(us, QUEEN);
+    while (b) { int from = PopLsb(b); AddMoves(board, list, from, BishopAttacks(from, occ) & allowed(from)); }
+
+    b = board.piecesOf(us, ROOK) | board.piecesOf(us, QUEEN);
+    while (b) { int from = PopLsb(b); AddMoves(board, list, from, RookAttacks(from, occ) & allowed(from)); }
+
+    // castling, the king may not start on, pass through or land on an attacked square
+    int rights = board.castlingRights() & (us == SIDE_WHITE ? (WHITE_OO | WHITE_OOO) : (BLACK_OO | BLACK_OOO));
+    int base = us == SIDE_WHITE ? 0 : 56;
+
+    if (rights && !checkers && king == base + 4)
+    {
+        Move m;
+        m.from = king;
+        m.flags = MOVE_CASTLE;
+
+        if ((rights & (WHITE_OO | BLACK_OO)) && !(occ & (SquareBit(base + 5) | SquareBit(base + 6))) &&
+            !AttackersTo(board, base + 5, them, occ) && !AttackersTo(board, base + 6, them, occ))
+        {
+            m.to = base + 6;
+            list.push(m);
+        }
+
+        if ((rights & (WHITE_OOO | BLACK_OOO)) && !(occ & (SquareBit(base + 1) | SquareBit(base + 2) | SquareBit(base + 3))) &&
+            !AttackersTo(board, base + 3, them, occ) && !AttackersTo(board, base + 2, them, occ))
+        {
+            m.to = base + 2;
+            list.push(m);
+        }
+    }
+}
+
+bool ValidateUci(const Board& board, const std::string& uci, Move& move)
+{
+    Move m;
+    if (!board.decodeUci(uci, m)) return false;
+
+    MoveList list;
+    GenerateLegal(board, list);
+
+    for (Move legal : list)
+    {
+        if (legal == m)
+        {
+            move = legal;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint64_t PerftLeaves(Board& board, int depth)
+{
+    MoveList list;
+    GenerateLegal(board, list);
+
+    if (depth == 1) return list.size;
+
+    uint64_t nodes = 0;
+
+    for (Move m : list)
+    {
+        Undo u;
+        board.make(m, u);
+        nodes += PerftLeaves(board, depth - 1);
+        board.unmake(u);
+    }
+
+    return nodes;
+}
+
+uint64_t Perft(Board& board, int depth)
+{
+    return depth <= 0 ? 1 : PerftLeaves(board, depth);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "board.h"
+
+struct MoveList
+{
+    Move moves[256];
+    int size = 0;
+
+    void push(Move m) { moves[size++] = m; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + size; }
+};
+
+Bitboard KnightAttacks(int sq);
+Bitboard KingAttacks(int sq);
+Bitboard PawnAttacks(int color, int sq);
+Bitboard BishopAttacks(int sq, Bitboard occupied);
+Bitboard RookAttacks(int sq, Bitboard occupied);
+Bitboard Between(int a, int b);
+Bitboard Line(int a, int b);
+
+bool IsAttacked(const Board& board, int sq, int byColor);
+bool InCheck(const Board& board);
+
+void GenerateLegal(const Board& board, MoveList& list);
+
+// rejects anything that is not a legal move in the current position
+bool ValidateUci(const Board& board, const std::string& uci, Move& move);
+
+uint64_t Perft(Board& board, int depth);
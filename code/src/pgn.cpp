@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "pgn.h"
+#include "movegen.h"
+
+static bool IsResult(const std::string& token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool ReadPgnGame(std::istream& in, PgnGame& game)
+{
+    game = {};
+
+    std::string line, token;
+    bool comment = false;
+    bool done = false;
+
+    auto flush = [&]
+    {
+        if (token.empty()) return;
+
+        if (IsResult(token)) done = true;
+        else
+        {
+            // strip move numbers, "12." "12..." or glued "12.e4"
+            size_t dots = token.find_last_of('.');
+            if (dots != std::string::npos) token.erase(0, dots + 1);
+
+            if (!token.empty() && token[0] != '$' && !isdigit((unsigned char)token[0])) game.san.push_back(token);
+        }
+
+        token.clear();
+    };
+
+    // the result token closes the game
+    while (!done && std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        if (!comment && !line.empty() && line[0] == '[')
+        {
+            size_t space = line.find(' ');
+            size_t open = line.find('"');
+            size_t close = line.rfind('"');
+
+            if (space != std::string::npos && open != std::string::npos && close > open)
+                game.tags[line.substr(1, space - 1)] = line.substr(open + 1, close - open - 1);
+
+            continue;
+        }
+
+        for (char c : line)
+        {
+            if (comment)
+            {
+                if (c == '}') comment = false;
+                continue;
+            }
+
+            if (c == '{') { flush(); comment = true; }
+            else if (c == ';') break;
+            else if (isspace((unsigned char)c)) flush();
+            else token += c;
+        }
+
+        flush();
+    }
+
+    return !game.san.empty() || !game.tags.empty();
+}
+
+bool SanToMove(const Board& board, const std::string& text, Move& move)
+{
+    std::string san;
+    for (char c : text) if (!strchr("+#!?", c)) san += c;
+
+    MoveList list;
+    GenerateLegal(board, list);
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0")
+    {
+        bool kingSide = san.size() == 3;
+
+        for (Move m : list)
+        {
+            if ((m.flags & MOVE_CASTLE) && (m.to > m.from) == kingSide)
+            {
+                move = m;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    int promotion = 0;
+    size_t eq = san.find('=');
+    if (eq != std::string::npos && eq + 1 < san.size())
+    {
+        const char* p = strchr("NBRQ", san[eq + 1]);
+        if (!p) return false;
+
+        promotion = KNIGHT + (p - "NBRQ");
+        san.erase(eq);
+    }
+    else if (san.size() >= 3 && strchr("NBRQ", san.back()) && isdigit(san[san.size() - 2]))
+    {
+        // some writers drop the '=' in e8Q
+        promotion = KNIGHT + (strchr("NBRQ", san.back()) - "NBRQ");
+        san.pop_back();
+    }
+
+    int kind = PAWN;
+    if (!san.empty() && strchr("NBRQK", san[0]))
+    {
+        kind = KNIGHT + (strchr("NBRQK", san[0]) - "NBRQK");
+        san.erase(0, 1);
+    }
+
+    san.erase(std::remove(san.begin(), san.end(), 'x'), san.end());
+    if (san.size() < 2) return false;
+
+    int to = ParseSquare(&san[san.size() - 2]);
+    if (to < 0) return false;
+
+    int fromFile = -1, fromRank = -1;
+    for (size_t i = 0; i + 2 < san.size(); i++)
+    {
+        if (san[i] >= 'a' && san[i] <= 'h') fromFile = san[i] - 'a';
+        else if (san[i] >= '1' && san[i] <= '8') fromRank = san[i] - '1';
+    }
+
+    int found = 0;
+
+    for (Move m : list)
+    {
+        if (m.to != to || PieceKind(board.pieceOn(m.from)) != kind || m.promotion != promotion) continue;
+        if (fromFile >= 0 && SquareFile(m.from) != fromFile) continue;
+        if (fromRank >= 0 && SquareRank(m.from) != fromRank) continue;
+
+        move = m;
+        found++;
+    }
+
+    return found == 1;
+}
+
+bool PgnStartBoard(const PgnGame& game, Board& board)
+{
+    auto it = game.tags.find("FEN");
+    if (it == game.tags.end())
+    {
+        board.reset();
+        return true;
+    }
+
+    return board.setFen(it->second);
+}
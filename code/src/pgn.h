@@ -0,0 +1,21 @@
+#pragma once
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+#include "board.h"
+
+struct PgnGame
+{
+    std::map<std::string, std::string> tags;
+    std::vector<std::string> san;
+};
+
+// reads the next game, false at end of input
+bool ReadPgnGame(std::istream& in, PgnGame& game);
+
+// resolves standard algebraic notation against the legal moves of the position
+bool SanToMove(const Board& board, const std::string& san, Move& move);
+
+// start position of a game, honouring SetUp/FEN tags
+bool PgnStartBoard(const PgnGame& game, Board& board);
@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <cmath>
+#include "plan.h"
+#include "cache.h"
+#include "config.h"
+#include "movegen.h"
+#include "route.h"
+#include "table.h"
+
+int squareSize = 32;
+
+int boardSize = 8 * squareSize;
+int offsetX = (WIDTH  - boardSize) / 2;
+int offsetY = (HEIGHT - boardSize) / 2;
+
+Vector2 CellCenter(Cell c)
+{
+    return {
+        offsetX + c.file * squareSize + squareSize / 2.0f,
+        offsetY + c.rank * squareSize + squareSize / 2.0f
+    };
+}
+
+float EaseInOut(float t)
+{
+    return (t < 0.5f)
+        ? 2.0f * t * t
+        : 1.0f - std::pow(-2.0f * t + 2.0f, 2.0f) / 2.0f;
+}
+
+std::vector<char> GenerateMove(Cell from, Cell to)
+{
+    std::vector<char> dirs;
+
+    int sX = from.file;
+    int sY = 7 - from.rank;
+    int eX = to.file;
+    int eY = 7 - to.rank;
+
+    while (sX != eX || sY != eY) {
+        if (sY < eY) { dirs.push_back('U'); sY++; }
+        else if (sY > eY) { dirs.push_back('D'); sY--; }
+        else if (sX < eX) { dirs.push_back('R'); sX++; }
+        else if (sX > eX) { dirs.push_back('L'); sX--; }
+    }
+
+    return dirs;
+}
+
+std::vector<Vector2> GetEdgePath(const std::vector<char>& dirs, Cell from, Cell to)
+{
+    std::vector<Vector2> vec;
+
+    int startCol = from.file;
+    int startRow = from.rank;
+    int endCol = to.file;
+    int endRow = to.rank;
+
+    float startCX = offsetX + startCol * squareSize + squareSize / 2.0f;
+    float startCY = offsetY + startRow * squareSize + squareSize / 2.0f;
+
+    float endCX = offsetX + endCol * squareSize + squareSize / 2.0f;
+    float endCY = offsetY + endRow * squareSize + squareSize / 2.0f;
+
+    float midX = (startCX + endCX) / 2.0f;
+    float midY = (startCY + endCY) / 2.0f;
+
+    vec.push_back({startCX, startCY});
+
+    int col = startCol;
+    int row = startRow;
+
+    for (size_t i = 0; i < dirs.size(); i++)
+    {
+        float cx = offsetX + col * squareSize + squareSize / 2.0f;
+        float cy = offsetY + row * squareSize + squareSize / 2.0f;
+
+        float dx = (midX >= cx) ? squareSize / 2.0f : -squareSize / 2.0f;
+        float dy = (midY >= cy) ? squareSize / 2.0f : -squareSize / 2.0f;
+
+        vec.push_back({cx + dx, cy + dy});
+
+        char d = dirs[i];
+
+        if (d == 'U') row--;
+        else if (d == 'D') row++;
+        else if (d == 'L') col--;
+        else if (d == 'R') col++;
+    }
+
+    float cx = offsetX + col * squareSize + squareSize / 2.0f;
+    float cy = offsetY + row * squareSize + squareSize / 2.0f;
+
+    float dx = (midX >= cx) ? squareSize / 2.0f : -squareSize / 2.0f;
+    float dy = (midY >= cy) ? squareSize / 2.0f : -squareSize / 2.0f;
+
+    vec.push_back({cx + dx, cy + dy});
+    vec.push_back({endCX, endCY});
+
+    vec.erase(
+    std::unique(vec.begin(), vec.end(),
+        [](const Vector2& a, const Vector2& b)
+        {
+            const float eps = 0.0001f;
+            return std::fabs(a.x - b.x) < eps && std::fabs(a.y - b.y) < eps;
+        }),
+    vec.end());
+
+    return vec;
+}
+
+std::vector<Vector2> BuildEasedCycle(const std::vector<Vector2>& base, int stepsPerSegment)
+{
+    std::vector<Vector2> result;
+
+    if (base.size() < 2) return base;
+
+    for (size_t i = 0; i < base.size() - 1; i++)
+    {
+        Vector2 a = base[i];
+        Vector2 b = base[i + 1];
+
+        for (int s = 0; s < stepsPerSegment; s++)
+        {
+            float t = (float)s / (float)stepsPerSegment;
+            t = EaseInOut(t);
+
+            Vector2 p;
+            p.x = a.x + (b.x - a.x) * t;
+            p.y = a.y + (b.y - a.y) * t;
+
+            result.push_back(p);
+        }
+    }
+
+    result.push_back(base.back());
+
+    return result;
+}
+
+std::vector<Vector2> SmoothPath(const std::vector<Vector2>& waypoints, float maxCut, float spacing)
+{
+    if (waypoints.size() < 3) return waypoints;
+
+    std::vector<Vector2> out = {waypoints.front()};
+
+    for (size_t i = 1; i + 1 < waypoints.size(); i++)
+    {
+        Vector2 a = waypoints[i - 1], c = waypoints[i], b = waypoints[i + 1];
+
+        float la = std::hypot(c.x - a.x, c.y - a.y);
+        float lb = std::hypot(b.x - c.x, b.y - c.y);
+
+        if (la < 1e-4f || lb < 1e-4f) continue;
+
+        Vector2 u = {(c.x - a.x) / la, (c.y - a.y) / la};
+        Vector2 v = {(b.x - c.x) / lb, (b.y - c.y) / lb};
+
+        // the blend's midpoint sits d |v - u| / 8 inside the corner, and
+        // each straight gives at most half its length to a blend
+        float turn = std::hypot(v.x - u.x, v.y - u.y);
+        float d = std::min({la / 2, lb / 2, turn > 1e-4f ? 8 * maxCut / turn : la / 2});
+
+        if (turn < 1e-4f || d < 1e-4f)
+        {
+            out.push_back(c);
+            continue;
+        }
+
+        Vector2 p0 = {c.x - u.x * d, c.y - u.y * d};
+        Vector2 p3 = {c.x + v.x * d, c.y + v.y * d};
+
+        // the blend is at most 2d long, and a sample every 3 degrees of
+        // turn or so keeps the chords on the curve
+        float angle = std::acos(std::clamp(u.x * v.x + u.y * v.y, -1.0f, 1.0f));
+        int n = std::max({4, (int)std::ceil(angle / 0.05f), (int)std::ceil(2 * d / spacing)});
+
+        for (int k = 0; k <= n; k++)
+        {
+            float t = (float)k / n, r = 1 - t;
+            float w0 = r * r * r, w1 = 3 * r * t, w3 = t * t * t;
+
+            // the two inner control points coincide at c, weights 3rt^2 + 3r^2t
+            Vector2 q = {w0 * p0.x + w1 * c.x + w3 * p3.x, w0 * p0.y + w1 * c.y + w3 * p3.y};
+
+            // back to back blends share the point between them
+            if (std::hypot(q.x - out.back().x, q.y - out.back().y) > 1e-4f) out.push_back(q);
+        }
+    }
+
+    out.push_back(waypoints.back());
+
+    return out;
+}
+
+uint64_t GraveyardBit(Cell c)
+{
+    if (c.rank < -1 || c.rank > 8) return 0;
+
+    int i = c.file == -2 ? 0 : c.file == -1 ? 1 : c.file == 8 ? 2 : c.file == 9 ? 3 : -1;
+
+    return i < 0 ? 0 : 1ull << (10 * i + c.rank + 1);
+}
+
+// which slots the arm reaches, and for each side a reachable cell past
+// the ends of its files for the one piece it can lose beyond them. the
+// corner slots can be out of reach of a short arm
+struct GraveyardReach
+{
+    uint64_t slots = 0;
+    Cell spare[2] = {};
+    bool hasSpare[2] = {};
+};
+
+static const GraveyardReach& Reach()
+{
+    static const GraveyardReach reach = []
+    {
+        GraveyardReach r;
+
+        auto Reached = [](Cell c)
+        {
+            Vector2 p = CellCenter(c);
+            return SolveIK(ARM_GEOMETRY, p.x, p.y).valid;
+        };
+
+        for (int file : {-2, -1, 8, 9})
+            for (int rank = 0; rank < 8; rank++)
+                if (Reached({file, rank})) r.slots |= GraveyardBit({file, rank});
+
+        const int files[2][2] = {{-1, -2}, {8, 9}};
+
+        for (int side : {SIDE_WHITE, SIDE_BLACK})
+        {
+            for (int file : files[side == SIDE_BLACK])
+            {
+                for (int rank : {-1, 8})
+                {
+                    if (r.hasSpare[side == SIDE_BLACK] || !Reached({file, rank})) continue;
+
+                    r.spare[side == SIDE_BLACK] = {file, rank};
+                    r.hasSpare[side == SIDE_BLACK] = true;
+                }
+            }
+        }
+
+        return r;
+    }();
+
+    return reach;
+}
+
+bool Graveyard::choose(int piece, Cell from, Cell next, Cell& slot) const
+{
+    auto Dist = [](Cell a, Cell b) { return std::hypot((float)(a.file - b.file), (float)(a.rank - b.rank)); };
+
+    int files[2] = {-1, -2};
+    if (PieceSide(piece) == SIDE_BLACK)
+    {
+        files[0] = 8;
+        files[1] = 9;
+    }
+
+    uint64_t free = Reach().slots & ~used;
+    float best = 1e30f;
+
+    for (int file : files)
+    {
+        for (int rank = 0; rank < 8; rank++)
+        {
+            Cell c = {file, rank};
+            if (!(free & GraveyardBit(c))) continue;
+
+            float d = Dist(from, c) + Dist(c, next);
+            if (d < best)
+            {
+                best = d;
+                slot = c;
+            }
+        }
+    }
+
+    return best < 1e30f;
+}
+
+bool Graveyard::spare(int piece, Cell& cell) const
+{
+    int i = PieceSide(piece) == SIDE_BLACK;
+    cell = Reach().spare[i];
+
+    return Reach().hasSpare[i] && !(used & GraveyardBit(cell));
+}
+
+static float PathLength(const std::vector<Vector2>& path)
+{
+    float length = 0;
+    for (size_t i = 1; i < path.size(); i++) length += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+
+    return length;
+}
+
+static void RouteLeg(Router& router, Bitboard& occupied, uint64_t& offBoard, Leg& leg)
+{
+    leg.table = trajectoryTable.route(leg.from, leg.to, occupied, offBoard, leg.path);
+    leg.key = leg.table ? 0 : TrajectoryCache::key(leg.from, leg.to, occupied, offBoard);
+
+    if (!leg.table && !trajectoryCache.findPath(leg.key, leg.path))
+    {
+        if (router.route(occupied, offBoard, leg.from, leg.to, leg.path))
+            trajectoryCache.storePath(leg.key, leg.from, leg.to, leg.path);
+        else
+        {
+            leg.path = GetEdgePath(GenerateMove(leg.from, leg.to), leg.from, leg.to);
+            leg.key = 0;
+        }
+    }
+
+    auto Bit = [](Cell c)
+    {
+        return c.file >= 0 && c.file < 8 && c.rank >= 0 && c.rank < 8 ? SquareBit(MakeSquare(c.file, c.rank)) : 0;
+    };
+
+    occupied = (occupied & ~Bit(leg.from)) | Bit(leg.to);
+    offBoard = (offBoard & ~GraveyardBit(leg.from)) | GraveyardBit(leg.to);
+}
+
+MovePlan PlanMove(const Board& board, Move m, Graveyard& graveyard, const Vector2* arm)
+{
+    // lattice ik is solved once per thread
+    thread_local Router router(ARM_GEOMETRY);
+    trajectoryCache.calibrate(ARM_GEOMETRY);
+
+    std::vector<Leg> legs;
+
+    int piece = board.pieceOn(m.from);
+    Cell from = SquareCell(m.from);
+    Cell to = SquareCell(m.to);
+
+    // the captured piece goes first when it stands on the target square.
+    // en passant takes the pawn beside it, which can go either side
+    bool clearFirst = false;
+
+    if (m.flags & MOVE_CAPTURE)
+    {
+        int victim = (m.flags & MOVE_EP) ? m.to ^ 8 : m.to;
+        int taken = board.pieceOn(victim);
+        Cell c = SquareCell(victim);
+        Cell slot;
+
+        // a side can lose 15 pieces, one more than the slots this arm reaches
+        if (!graveyard.choose(taken, c, from, slot) && !graveyard.spare(taken, slot))
+        {
+            MovePlan none;
+            none.hasStart = arm != nullptr;
+            if (arm) none.start = *arm;
+
+            return none;
+        }
+
+        legs.push_back({c, slot, taken});
+        clearFirst = !(m.flags & MOVE_EP);
+    }
+
+    int main = (int)legs.size();
+    legs.push_back({from, to, piece});
+
+    if (m.flags & MOVE_CASTLE)
+    {
+        bool kingSide = m.to > m.from;
+        int rookFrom = kingSide ? m.to + 1 : m.to - 2;
+        int rookTo = kingSide ? m.to - 1 : m.to + 1;
+
+        legs.push_back({SquareCell(rookFrom), SquareCell(rookTo), board.pieceOn(rookFrom)});
+    }
+
+    // at most three legs, so every order is tried. each is routed against
+    // the pieces the legs before it left behind
+    std::vector<int> order(legs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+
+    MovePlan plan;
+    float best = 1e30f;
+
+    do
+    {
+        if (clearFirst && order[0] != 0) continue;
+
+        MovePlan candidate;
+        candidate.hasStart = arm != nullptr;
+        if (arm) candidate.start = *arm;
+
+        Bitboard occupied = board.occupancy();
+        uint64_t offBoard = graveyard.occupancy();
+        float travel = 0;
+
+        for (int i : order)
+        {
+            Leg leg = legs[i];
+            RouteLeg(router, occupied, offBoard, leg);
+
+            travel += PathLength(leg.path);
+            if (!candidate.legs.empty() || arm)
+            {
+                Vector2 a = PlanEnd(candidate), b = leg.path.front();
+                travel += std::hypot(b.x - a.x, b.y - a.y);
+            }
+
+            candidate.legs.push_back(std::move(leg));
+        }
+
+        if (travel < best)
+        {
+            best = travel;
+            plan = std::move(candidate);
+        }
+    }
+    while (std::next_permutation(order.begin(), order.end()));
+
+    if (main > 0) graveyard.take(legs[0].to);
+
+    return plan;
+}
+
+Vector2 ParkPoint(const Board& board)
+{
+    MoveList list;
+    GenerateLegal(board, list);
+
+    Bitboard from = 0;
+    for (const Move& m : list) from |= SquareBit(m.from);
+
+    if (!from) return CellCenter({3, 3});
+
+    Vector2 sum = {0, 0};
+    int n = PopCount(from);
+
+    while (from)
+    {
+        Vector2 c = CellCenter(SquareCell(PopLsb(from)));
+        sum.x += c.x;
+        sum.y += c.y;
+    }
+
+    return {sum.x / n, sum.y / n};
+}
+
+std::vector<Vector2> BuildPlanPath(const MovePlan& plan)
+{
+    std::vector<Vector2> path;
+    if (plan.hasStart) path.push_back(plan.start);
+
+    for (const Leg& leg : plan.legs)
+    {
+        std::vector<Vector2> seg = BuildEasedCycle(leg.path, 4);
+
+        // the empty arm runs straight to the start of the next leg
+        if (!path.empty())
+        {
+            std::vector<Vector2> transit = BuildEasedCycle({path.back(), seg.front()}, 4);
+            path.insert(path.end(), transit.begin() + 1, transit.end() - 1);
+        }
+
+        path.insert(path.end(), seg.begin(), seg.end());
+    }
+
+    return path;
+}
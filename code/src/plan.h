@@ -0,0 +1,108 @@
+#pragma once
+#include <raylib.h>
+#include <vector>
+#include "board.h"
+
+extern int squareSize;
+extern int boardSize;
+extern int offsetX;
+extern int offsetY;
+
+// how far a blended corner may cut in off the square edges, in squares.
+// a dragged piece keeps well clear of the pieces on the squares it skirts
+const float CORNER_CUT = 0.15f;
+
+// board cell in file/rank units, cells outside 0..7 are off the board
+struct Cell
+{
+    int file;
+    int rank;
+};
+
+inline Cell SquareCell(int sq) { return {SquareFile(sq), SquareRank(sq)}; }
+
+Vector2 CellCenter(Cell c);
+
+// one piece dragged from one cell to another with the magnet on, along
+// path, centre to centre
+struct Leg
+{
+    Leg() = default;
+    Leg(Cell from, Cell to, int piece) : from(from), to(to), piece(piece) {}
+
+    Cell from;
+    Cell to;
+    int piece = NO_PIECE;
+    std::vector<Vector2> path;
+    uint64_t key = 0;   // trajectory cache key, 0 when not cached
+    bool table = false;   // free board route, solved in the trajectory table
+};
+
+struct MovePlan
+{
+    std::vector<Leg> legs;
+
+    // where the arm rests before the first leg, when known
+    bool hasStart = false;
+    Vector2 start = {};
+};
+
+// where the arm comes to rest after the plan
+inline Vector2 PlanEnd(const MovePlan& plan) { return plan.legs.empty() ? plan.start : plan.legs.back().path.back(); }
+
+// off board slots for captured pieces, two files either side of the
+// board: white's pieces go left of the a file, black's right of the h
+// file. the slots are ranks 0..7 of files -2, -1, 8 and 9, and the cells
+// just past their ends, ranks -1 and 8, hold the spare. bit
+// 10 * i + rank + 1 for file i of the four
+uint64_t GraveyardBit(Cell c);
+
+// which slots are taken, kept for the whole game
+class Graveyard
+{
+public:
+    // the free slot on the piece's side that is cheapest to carry it to
+    // from from and then leave for next, false when that side has no free
+    // slot the arm reaches
+    bool choose(int piece, Cell from, Cell next, Cell& slot) const;
+
+    // a reachable cell off the end of the piece's graveyard files, for
+    // the one piece a side can lose once every slot the arm reaches is
+    // full. false when there is none or it is taken
+    bool spare(int piece, Cell& cell) const;
+
+    void take(Cell slot) { used |= GraveyardBit(slot); }
+    void clear() { used = 0; }
+
+    uint64_t occupancy() const { return used; }
+    int count() const { return PopCount(used); }
+
+private:
+    uint64_t used = 0;
+};
+
+float EaseInOut(float t);
+std::vector<char> GenerateMove(Cell from, Cell to);
+std::vector<Vector2> GetEdgePath(const std::vector<char>& dirs, Cell from, Cell to);
+std::vector<Vector2> BuildEasedCycle(const std::vector<Vector2>& base, int stepsPerSegment);
+
+// rounds every corner of the polyline with a cubic bezier whose inner
+// control points both sit on the corner. curvature is zero where the
+// blend meets the straights, so the path is curvature continuous and the
+// arm need not stop. a blend cuts inside the corner by at most maxCut and
+// is sampled no more than spacing apart
+std::vector<Vector2> SmoothPath(const std::vector<Vector2>& waypoints, float maxCut, float spacing);
+
+// physical legs for a legal move, planned against the board before it is
+// made. a captured piece is carried to a graveyard slot, which is taken.
+// the legs run in the order with the least travel, counting the empty
+// arm's transits between them and, when arm is given, from arm to the
+// first. each leg is routed around the pieces still standing when it
+// runs, falling back to the square edges when the router finds no way
+// through. no legs when a captured piece has nowhere in reach to go
+MovePlan PlanMove(const Board& board, Move m, Graveyard& graveyard, const Vector2* arm = nullptr);
+
+// where to wait for the side to move, the middle of the squares it can
+// move from, so the transit to its reply is short whatever it plays
+Vector2 ParkPoint(const Board& board);
+std::vector<Vector2> BuildPlanPath(const MovePlan& plan);
@@ -0,0 +1,82 @@
+#include "ponder.h"
+#include "config.h"
+#include "movegen.h"
+
+void LinePlanner::prepare(const Board& board, const Graveyard& graveyard, Vector2 arm, const std::vector<std::string>& line)
+{
+    cancel();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        moves.clear();
+        finished = false;
+    }
+
+    quit = false;
+    worker = std::thread(&LinePlanner::run, this, board, graveyard, arm, line);
+}
+
+bool LinePlanner::take(const Board& board, const std::string& uci, PreparedMove& out)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t seen = 0;
+
+    while (true)
+    {
+        for (; seen < moves.size(); seen++)
+        {
+            if (moves[seen].key != board.key() || moves[seen].uci != uci) continue;
+
+            out = std::move(moves[seen]);
+            moves.erase(moves.begin(), moves.begin() + seen + 1);
+
+            return true;
+        }
+
+        if (finished) return false;
+
+        planned.wait(lock);
+    }
+}
+
+void LinePlanner::cancel()
+{
+    quit = true;
+    if (worker.joinable()) worker.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    moves.clear();
+    finished = true;
+}
+
+void LinePlanner::run(Board board, Graveyard graveyard, Vector2 arm, std::vector<std::string> line)
+{
+    for (const std::string& uci : line)
+    {
+        Move m;
+        Undo u;
+
+        if (quit || !ValidateUci(board, uci, m)) break;
+
+        PreparedMove p;
+        p.key = board.key();
+        p.uci = uci;
+        p.plan = PlanMove(board, m, graveyard, &arm);
+        if (p.plan.legs.empty()) break;
+
+        p.points = BuildPlanPath(p.plan);
+        p.trajectory = PlanTrajectory(ARM_GEOMETRY, p.plan, MOTOR_LIMITS, TRANSIT_LIMITS, 1.0 / CONTROL_HZ);
+        p.graveyard = graveyard;
+
+        arm = PlanEnd(p.plan);
+        board.make(m, u);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        moves.push_back(std::move(p));
+        planned.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+    planned.notify_all();
+}
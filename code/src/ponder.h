@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "plan.h"
+#include "trajectory.h"
+
+// a move with everything the arm needs to play it
+struct PreparedMove
+{
+    uint64_t key = 0;   // position it is played from
+    std::string uci;
+    MovePlan plan;
+    std::vector<Vector2> points;
+    Trajectory trajectory;
+    Graveyard graveyard;   // slots taken once it is played
+};
+
+// plans the arm for a line of moves the engine expects on a thread of its
+// own, while the players think, so a predicted move starts at once
+class LinePlanner
+{
+public:
+    ~LinePlanner() { cancel(); }
+
+    // drops the line before. board, graveyard and arm are as they will be
+    // before the first move of the new line
+    void prepare(const Board& board, const Graveyard& graveyard, Vector2 arm, const std::vector<std::string>& line);
+
+    // the move prepared for uci from board, waiting while the planner is
+    // still on its way there. false when the line went elsewhere
+    bool take(const Board& board, const std::string& uci, PreparedMove& out);
+
+    void cancel();
+
+private:
+    void run(Board board, Graveyard graveyard, Vector2 arm, std::vector<std::string> line);
+
+    std::thread worker;
+    std::atomic<bool> quit{false};
+
+    std::mutex mutex;
+    std::condition_variable planned;
+    std::vector<PreparedMove> moves;
+    bool finished = true;
+};
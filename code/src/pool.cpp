@@ -0,0 +1,113 @@
+#include <chrono>
+#include "pool.h"
+
+static thread_local int workerIndex = -1;
+static thread_local const void* workerPool = nullptr;
+
+TaskPool::TaskPool(int count)
+{
+    if (count < 1) count = 1;
+
+    // one extra queue for tasks submitted from outside the pool
+    for (int i = 0; i <= count; i++) queues.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < count; i++) threads.emplace_back(&TaskPool::workerLoop, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit = true;
+    }
+    sleepCv.notify_all();
+
+    for (std::thread& t : threads) t.join();
+}
+
+void TaskPool::submit(std::function<void()> task)
+{
+    int target = workerPool == this ? workerIndex : (int)(nextQueue++ % queues.size());
+
+    pending++;
+    queued++;
+
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    sleepCv.notify_one();
+}
+
+bool TaskPool::runOne(int self)
+{
+    std::function<void()> task;
+    int n = (int)queues.size();
+
+    if (self >= 0)
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    for (int i = 1; !task && i <= n; i++)
+    {
+        Queue& victim = *queues[(self + n + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            stolen++;
+        }
+    }
+
+    if (!task) return false;
+
+    queued--;
+    task();
+
+    if (--pending == 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCv.notify_all();
+    }
+
+    return true;
+}
+
+void TaskPool::workerLoop(int index)
+{
+    workerIndex = index;
+    workerPool = this;
+
+    while (!quit)
+    {
+        if (runOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCv.wait_for(lock, std::chrono::milliseconds(5), [&] { return quit || queued > 0; });
+    }
+}
+
+void TaskPool::wait()
+{
+    // the waiting thread helps instead of idling
+    while (pending > 0)
+    {
+        if (runOne(workerPool == this ? workerIndex : (int)queues.size() - 1)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCv.wait_for(lock, std::chrono::milliseconds(1), [&] { return pending == 0; });
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work stealing pool: each worker pops its own deque from the back and
+// steals from the front of the others when it runs dry
+class TaskPool
+{
+public:
+    explicit TaskPool(int threads);
+    ~TaskPool();
+
+    void submit(std::function<void()> task);
+    void wait();
+
+    int size() const { return (int)threads.size(); }
+    uint64_t steals() const { return stolen.load(); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool runOne(int self);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::atomic<int> pending{0};
+    std::atomic<int> queued{0};
+    std::atomic<unsigned> nextQueue{0};
+    std::atomic<uint64_t> stolen{0};
+    std::atomic<bool> quit{false};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+};
@@ -0,0 +1,195 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "process.h"
+
+extern char** environ;
+
+static bool OpenPipe(int fds[2])
+{
+#if defined(__linux__)
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    return true;
+#endif
+}
+
+static void SetNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void CloseFd(int& fd)
+{
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+
+Process::~Process()
+{
+    terminate(0);
+}
+
+bool Process::spawn(const std::string& path, const std::vector<std::string>& args)
+{
+    if (pid > 0) return false;
+
+    int toChild[2], fromChild[2];
+
+    if (!OpenPipe(toChild)) return false;
+    if (!OpenPipe(fromChild))
+    {
+        close(toChild[0]);
+        close(toChild[1]);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, toChild[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fromChild[1], STDOUT_FILENO);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(path.c_str()));
+    for (const std::string& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    int err = posix_spawnp(&pid, path.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(toChild[0]);
+    close(fromChild[1]);
+
+    if (err != 0)
+    {
+        pid = -1;
+        close(toChild[1]);
+        close(fromChild[0]);
+        return false;
+    }
+
+    in = toChild[1];
+    out = fromChild[0];
+    status = -1;
+
+    SetNonBlocking(in);
+    SetNonBlocking(out);
+
+    // a dead engine must not take the controller down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    return true;
+}
+
+bool Process::reap(bool block)
+{
+    if (pid <= 0) return true;
+
+    int st = 0;
+    pid_t r;
+
+    do r = waitpid(pid, &st, block ? 0 : WNOHANG);
+    while (r < 0 && errno == EINTR);
+
+    if (r == 0) return false;
+
+    status = (r == pid && WIFEXITED(st)) ? WEXITSTATUS(st) : -1;
+    pid = -1;
+
+    return true;
+}
+
+void Process::terminate(int graceMs)
+{
+    closeInput();
+
+    if (pid > 0)
+    {
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(graceMs);
+
+        while (!reap(false) && std::chrono::steady_clock::now() < end)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        if (pid > 0)
+        {
+            kill(pid, SIGKILL);
+            reap(true);
+        }
+    }
+
+    CloseFd(out);
+}
+
+bool Process::running()
+{
+    return pid > 0 && !reap(false);
+}
+
+void Process::closeInput()
+{
+    CloseFd(in);
+}
+
+bool Process::writeAll(const char* data, size_t size, int timeoutMs)
+{
+    size_t off = 0;
+
+    while (off < size)
+    {
+        if (in < 0) return false;
+
+        ssize_t n = ::write(in, data + off, size - off);
+
+        if (n > 0)
+        {
+            off += n;
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+
+        pollfd p = {in, POLLOUT, 0};
+        if (::poll(&p, 1, timeoutMs) <= 0) return false;
+        if (p.revents & (POLLERR | POLLHUP)) return false;
+    }
+
+    return true;
+}
+
+int Process::waitReadable(int timeoutMs)
+{
+    if (out < 0) return -1;
+
+    pollfd p = {out, POLLIN, 0};
+
+    int r = ::poll(&p, 1, timeoutMs);
+    if (r < 0) return errno == EINTR ? 0 : -1;
+    if (r == 0) return 0;
+
+    // POLLHUP still leaves buffered output to drain, read() reports the end
+    return 1;
+}
+
+ssize_t Process::read(char* buffer, size_t size)
+{
+    if (out < 0) return 0;
+
+    ssize_t n;
+
+    do n = ::read(out, buffer, size);
+    while (n < 0 && errno == EINTR);
+
+    return n;
+}
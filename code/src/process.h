@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// child process with separate non-blocking stdin/stdout pipes
+class Process
+{
+public:
+    ~Process();
+
+    bool spawn(const std::string& path, const std::vector<std::string>& args = {});
+    void terminate(int graceMs);
+
+    bool running();
+    int exitStatus() const { return status; }
+
+    bool writeAll(const char* data, size_t size, int timeoutMs);
+    int waitReadable(int timeoutMs);
+    ssize_t read(char* buffer, size_t size);
+
+    void closeInput();
+
+private:
+    bool reap(bool block);
+
+    pid_t pid = -1;
+    int in = -1;
+    int out = -1;
+    int status = -1;
+};
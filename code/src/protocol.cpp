@@ -0,0 +1,151 @@
+#include "protocol.h"
+
+uint16_t Crc16(const uint8_t* data, size_t size, uint16_t crc)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+
+        for (int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+
+    return crc;
+}
+
+static void Put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t Get16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+size_t EncodeFrame(uint8_t type, uint8_t seq, const uint8_t* payload, size_t length, uint8_t* out)
+{
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = type;
+    out[3] = seq;
+    out[4] = (uint8_t)length;
+
+    for (size_t i = 0; i < length; i++) out[FRAME_HEADER + i] = payload[i];
+
+    Put16(out + FRAME_HEADER + length, Crc16(out + 2, 3 + length));
+
+    return FRAME_OVERHEAD + length;
+}
+
+size_t EncodeSetpoints(uint8_t seq, uint8_t flags, const WireSetpoint* setpoints, int count, uint8_t* out)
+{
+    uint8_t payload[2 + 4 * BATCH_SETPOINTS];
+
+    payload[0] = flags;
+    payload[1] = (uint8_t)count;
+
+    for (int i = 0; i < count; i++)
+    {
+        Put16(payload + 2 + 4 * i, (uint16_t)setpoints[i].theta1);
+        Put16(payload + 4 + 4 * i, (uint16_t)setpoints[i].theta2);
+    }
+
+    return EncodeFrame(FRAME_SETPOINTS, seq, payload, 2 + 4 * count, out);
+}
+
+size_t EncodeCredit(const CreditReport& r, uint8_t* out)
+{
+    uint8_t payload[7];
+
+    payload[0] = r.ack;
+    Put16(payload + 1, r.free);
+    Put16(payload + 3, r.depth);
+    Put16(payload + 5, r.underruns);
+
+    return EncodeFrame(FRAME_CREDIT, 0, payload, sizeof(payload), out);
+}
+
+bool DecodeSetpoints(const Frame& f, uint8_t& flags, WireSetpoint* setpoints, int& count)
+{
+    if (f.type != FRAME_SETPOINTS || f.length < 2) return false;
+
+    flags = f.payload[0];
+    count = f.payload[1];
+
+    if (count > BATCH_SETPOINTS || f.length != 2 + 4 * count) return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        setpoints[i].theta1 = (int16_t)Get16(f.payload + 2 + 4 * i);
+        setpoints[i].theta2 = (int16_t)Get16(f.payload + 4 + 4 * i);
+    }
+
+    return true;
+}
+
+bool DecodeCredit(const Frame& f, CreditReport& r)
+{
+    if (f.type != FRAME_CREDIT || f.length != 7) return false;
+
+    r.ack = f.payload[0];
+    r.free = Get16(f.payload + 1);
+    r.depth = Get16(f.payload + 3);
+    r.underruns = Get16(f.payload + 5);
+
+    return true;
+}
+
+bool FrameParser::feed(uint8_t b)
+{
+    switch (state)
+    {
+    case SYNC0:
+        if (b == FRAME_SYNC0) state = SYNC1;
+        return false;
+
+    case SYNC1:
+        state = b == FRAME_SYNC1 ? TYPE : (b == FRAME_SYNC0 ? SYNC1 : SYNC0);
+        return false;
+
+    case TYPE:
+        current.type = b;
+        crc = Crc16(&b, 1);
+        state = SEQ;
+        return false;
+
+    case SEQ:
+        current.seq = b;
+        crc = Crc16(&b, 1, crc);
+        state = LENGTH;
+        return false;
+
+    case LENGTH:
+        current.length = b;
+        crc = Crc16(&b, 1, crc);
+        index = 0;
+        state = b ? PAYLOAD : CRC_LO;
+        return false;
+
+    case PAYLOAD:
+        current.payload[index++] = b;
+        crc = Crc16(&b, 1, crc);
+        if (index == current.length) state = CRC_LO;
+        return false;
+
+    case CRC_LO:
+        index = b;
+        state = CRC_HI;
+        return false;
+
+    case CRC_HI:
+        state = SYNC0;
+
+        if ((uint16_t)(index | (b << 8)) == crc) return true;
+
+        errors++;
+        return false;
+    }
+
+    return false;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// framed binary link between the planner and the motor controller. every
+// frame is
+//
+//   0xa5 0x5a type seq length payload[length] crc_lo crc_hi
+//
+// with a crc16 ccitt (0x1021, from 0xffff) over type, seq, length and the
+// payload. multi byte fields are little endian and packed by hand, so the
+// same code builds for the controller. the host numbers its frames, the
+// controller takes them strictly in order and answers with credits: the
+// last sequence number it took and the setpoint slots left in its queue.
+// the host never has more setpoints in flight than that, and on a nak or
+// a silence it goes back to the first frame not acknowledged
+const uint8_t FRAME_SYNC0 = 0xa5;
+const uint8_t FRAME_SYNC1 = 0x5a;
+
+const int FRAME_HEADER = 5;
+const int FRAME_OVERHEAD = FRAME_HEADER + 2;
+const int FRAME_PAYLOAD_MAX = 255;
+
+enum FrameType : uint8_t
+{
+    // host to controller
+    FRAME_RESET = 0x01,       // empty the queue, seq restarts after this one
+    FRAME_SETPOINTS = 0x02,   // flags, count, count x (theta1, theta2) in encoder counts
+
+    // controller to host
+    FRAME_CREDIT = 0x81,      // ack seq, free slots, queue depth, underruns
+    FRAME_NAK = 0x82,         // the seq the controller is waiting for
+};
+
+// setpoints per full batch, one every control tick. 32 of them are 137
+// bytes on the wire, so a 1 khz stream needs 43 kbaud at 10 bits a byte
+const int BATCH_SETPOINTS = 32;
+
+// the last batch of a trajectory, the controller may run dry after it
+const uint8_t SETPOINTS_END = 0x01;
+
+struct WireSetpoint
+{
+    int16_t theta1;
+    int16_t theta2;
+};
+
+struct CreditReport
+{
+    uint8_t ack;          // last seq taken in order
+    uint16_t free;        // setpoint slots left
+    uint16_t depth;       // setpoints queued
+    uint16_t underruns;   // ticks the queue was empty mid trajectory, wraps
+};
+
+struct Frame
+{
+    uint8_t type;
+    uint8_t seq;
+    uint8_t length;
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+};
+
+uint16_t Crc16(const uint8_t* data, size_t size, uint16_t crc = 0xffff);
+
+// each writes a whole frame to out and returns its size, out has room
+// for FRAME_OVERHEAD + FRAME_PAYLOAD_MAX bytes
+size_t EncodeFrame(uint8_t type, uint8_t seq, const uint8_t* payload, size_t length, uint8_t* out);
+size_t EncodeSetpoints(uint8_t seq, uint8_t flags, const WireSetpoint* setpoints, int count, uint8_t* out);
+size_t EncodeCredit(const CreditReport& r, uint8_t* out);
+
+// false when the payload is not the size its type needs
+bool DecodeSetpoints(const Frame& f, uint8_t& flags, WireSetpoint* setpoints, int& count);
+bool DecodeCredit(const Frame& f, CreditReport& r);
+
+// byte at a time, resynchronises on the sync pair after a bad frame
+class FrameParser
+{
+public:
+    // true when b completes a frame with a good crc, held in frame()
+    bool feed(uint8_t b);
+
+    const Frame& frame() const { return current; }
+    uint32_t crcErrors() const { return errors; }
+
+private:
+    enum State : uint8_t { SYNC0, SYNC1, TYPE, SEQ, LENGTH, PAYLOAD, CRC_LO, CRC_HI };
+
+    State state = SYNC0;
+    Frame current = {};
+    int index = 0;
+    uint16_t crc = 0;
+    uint32_t errors = 0;
+};
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "route.h"
+
+// 8 headings, counterclockwise from +file, in half square steps
+const int STEP_FILE[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int STEP_RANK[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// no heading before the first step
+const int NO_HEADING = 8;
+const int STATES_PER_NODE = 9;
+
+Router::Router(const FiveBar& g, RouteWeights w) : weights(w)
+{
+    columns = 2 * (ROUTE_FILE_HI - ROUTE_FILE_LO) + 1;
+    rows = 2 * (ROUTE_RANK_HI - ROUTE_RANK_LO) + 1;
+
+    int nodes = columns * rows;
+    theta1.resize(nodes);
+    theta2.resize(nodes);
+    reachable.resize(nodes);
+
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < columns; c++)
+        {
+            int n = r * columns + c;
+            double x = offsetX + (ROUTE_FILE_LO + c * 0.5) * squareSize;
+            double y = offsetY + (ROUTE_RANK_LO + r * 0.5) * squareSize;
+            double t1, t2;
+
+            reachable[n] = SolveIKPrecise(g, x, y, t1, t2);
+            theta1[n] = (float)t1;
+            theta2[n] = (float)t2;
+        }
+    }
+
+    int states = nodes * STATES_PER_NODE;
+    cost.resize(states);
+    parent.resize(states);
+    seen.assign(states, 0);
+    closed.assign(states, 0);
+    open.reserve((size_t)states * 8);
+    trail.reserve(nodes);
+}
+
+bool Router::route(Bitboard occupied, uint64_t offBoard, Cell from, Cell to, std::vector<Vector2>& out)
+{
+    expandedCount = 0;
+
+    auto Inside = [](Cell c)
+    {
+        return c.file >= ROUTE_FILE_LO && c.file < ROUTE_FILE_HI && c.rank >= ROUTE_RANK_LO && c.rank < ROUTE_RANK_HI;
+    };
+
+    if (!Inside(from) || !Inside(to)) return false;
+
+    // the moving piece leaves its own square and may land on a capture
+    Bitboard blocked = occupied;
+    if (from.file >= 0 && from.file < 8 && from.rank >= 0 && from.rank < 8) blocked &= ~SquareBit(MakeSquare(from.file, from.rank));
+    if (to.file >= 0 && to.file < 8 && to.rank >= 0 && to.rank < 8) blocked &= ~SquareBit(MakeSquare(to.file, to.rank));
+
+    uint64_t graves = offBoard & ~GraveyardBit(from) & ~GraveyardBit(to);
+
+    auto Node = [&](Cell c) { return (2 * (c.rank - ROUTE_RANK_LO) + 1) * columns + 2 * (c.file - ROUTE_FILE_LO) + 1; };
+
+    int start = Node(from);
+    int goal = Node(to);
+    int gc = goal % columns, gr = goal / columns;
+
+    if (!reachable[start] || !reachable[goal]) return false;
+
+    // straight line length in squares never overestimates
+    auto Heuristic = [&](int n)
+    {
+        float dc = (float)(n % columns - gc), dr = (float)(n / columns - gr);
+        return weights.length * 0.5f * std::sqrt(dc * dc + dr * dr);
+    };
+
+    // a fresh stamp stands in for clearing the state arrays
+    if (++query == 0)
+    {
+        std::fill(seen.begin(), seen.end(), 0);
+        std::fill(closed.begin(), closed.end(), 0);
+        query = 1;
+    }
+
+    open.clear();
+
+    int first = start * STATES_PER_NODE + NO_HEADING;
+    cost[first] = 0;
+    parent[first] = -1;
+    seen[first] = query;
+    open.push_back({Heuristic(start), first});
+
+    int found = -1;
+
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<>());
+        int s = open.back().second;
+        open.pop_back();
+
+        if (closed[s] == query) continue;
+        closed[s] = query;
+        expandedCount++;
+
+        int n = s / STATES_PER_NODE;
+        int heading = s % STATES_PER_NODE;
+
+        if (n == goal)
+        {
+            found = s;
+            break;
+        }
+
+        int c = n % columns, r = n / columns;
+
+        for (int d = 0; d < 8; d++)
+        {
+            // nothing sharper than a right angle
+            int turns = 0;
+            if (heading != NO_HEADING)
+            {
+                turns = std::abs(d - heading);
+                turns = std::min(turns, 8 - turns);
+                if (turns > 2) continue;
+            }
+
+            int nc = c + STEP_FILE[d], nr = r + STEP_RANK[d];
+            if (nc < 0 || nc >= columns || nr < 0 || nr >= rows) continue;
+
+            int next = nr * columns + nc;
+            if (!reachable[next]) continue;
+
+            // off the lanes the step crosses the inside of a square
+            Cell q;
+            if (StepSquare(c, r, STEP_FILE[d], STEP_RANK[d], q))
+            {
+                if (q.file >= 0 && q.file < 8 && q.rank >= 0 && q.rank < 8 && (blocked & SquareBit(MakeSquare(q.file, q.rank)))) continue;
+                if (graves & GraveyardBit(q)) continue;
+            }
+
+            float length = (d & 1) ? 0.70710678f : 0.5f;
+            float effort = std::fabs(theta1[next] - theta1[n]) + std::fabs(theta2[next] - theta2[n]);
+            float g = cost[s] + weights.length * length + weights.effort * effort + weights.turn * turns;
+
+            int t = next * STATES_PER_NODE + d;
+            if (closed[t] == query || (seen[t] == query && cost[t] <= g)) continue;
+
+            seen[t] = query;
+            cost[t] = g;
+            parent[t] = s;
+
+            open.push_back({g + Heuristic(next), t});
+            std::push_heap(open.begin(), open.end(), std::greater<>());
+        }
+    }
+
+    if (found < 0) return false;
+
+    trail.clear();
+    for (int s = found; s >= 0; s = parent[s]) trail.push_back(s);
+
+    auto Point = [&](int s)
+    {
+        int n = s / STATES_PER_NODE;
+        return LatticePoint(n % columns, n / columns);
+    };
+
+    // keep the ends and the nodes where the heading changes
+    out.clear();
+    out.push_back(Point(trail.back()));
+
+    for (int i = (int)trail.size() - 2; i >= 1; i--)
+        if (trail[i] % STATES_PER_NODE != trail[i - 1] % STATES_PER_NODE) out.push_back(Point(trail[i]));
+
+    if (trail.size() > 1) out.push_back(Point(trail.front()));
+
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <raylib.h>
+#include "board.h"
+#include "kinematics.h"
+#include "plan.h"
+
+// cells the router can reach, the board plus two files either side for
+// captured pieces and a rank above and below
+const int ROUTE_FILE_LO = -2;
+const int ROUTE_FILE_HI = 10;
+const int ROUTE_RANK_LO = -1;
+const int ROUTE_RANK_HI = 9;
+
+// lattice node (c, r) is at half squares from the corner of cell
+// (ROUTE_FILE_LO, ROUTE_RANK_LO), square centres where both are odd
+inline Vector2 LatticePoint(int c, int r)
+{
+    return {offsetX + (ROUTE_FILE_LO + c * 0.5f) * squareSize, offsetY + (ROUTE_RANK_LO + r * 0.5f) * squareSize};
+}
+
+// the square whose inside the step (dc, dr) from node (c, r) crosses, the
+// one holding its midpoint. false when the step runs along an edge lane
+inline bool StepSquare(int c, int r, int dc, int dr, Cell& square)
+{
+    if ((dc == 0 && c % 2 == 0) || (dr == 0 && r % 2 == 0)) return false;
+
+    square = {ROUTE_FILE_LO + (2 * c + dc) / 4, ROUTE_RANK_LO + (2 * r + dr) / 4};
+
+    return true;
+}
+
+// cost of a route in squares of travel: length, plus a charge for every
+// change of heading, plus the joint motion it takes in radians
+struct RouteWeights
+{
+    float length = 1.0f;
+    float turn = 0.4f;
+    float effort = 2.0f;
+};
+
+// a* over a half square lattice of square centres, edge midpoints and
+// corners, 8 way steps. a step that leaves the edge lanes crosses the
+// inside of a square and needs that square empty, so a dragged piece
+// never passes over another. search state is sized once up front and
+// reused, a query does not touch the heap
+class Router
+{
+public:
+    explicit Router(const FiveBar& g, RouteWeights w = {});
+
+    // corners of the cheapest route between the centres of from and to,
+    // false when there is none. offBoard holds the taken graveyard slots,
+    // from and to may be occupied
+    bool route(Bitboard occupied, uint64_t offBoard, Cell from, Cell to, std::vector<Vector2>& out);
+
+    // states taken off the open set by the last query
+    int expanded() const { return expandedCount; }
+
+private:
+    int columns = 0;
+    int rows = 0;
+
+    RouteWeights weights;
+
+    // per lattice node, joint angles from ik, false where out of reach
+    std::vector<float> theta1, theta2;
+    std::vector<uint8_t> reachable;
+
+    // per state, node * 9 + heading, heading 8 for the start
+    std::vector<float> cost;
+    std::vector<int32_t> parent;
+    std::vector<uint32_t> seen;
+    std::vector<uint32_t> closed;
+    std::vector<std::pair<float, int32_t>> open;
+    std::vector<int32_t> trail;
+    uint32_t query = 0;
+
+    int expandedCount = 0;
+};
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+#include "sim.h"
+
+// the short way round, so a joint never swings through 2 pi at the +-pi seam
+static float LerpAngle(float a, float b, float t)
+{
+    return a + std::remainder(b - a, 6.28318530718f) * t;
+}
+
+Simulation::Simulation(const FiveBar& g, double controlHz, double pointRate)
+    : geometry(g), dt(1.0 / controlHz), pathPointsPerTick(pointRate / controlHz), pointsPerTick(pathPointsPerTick)
+{
+    IKSolution s = SolveIK(g, (g.ax + g.ex) / 2, g.ay + g.l1);
+
+    current.theta1 = s.theta1;
+    current.theta2 = s.theta2;
+    current.x = (g.ax + g.ex) / 2;
+    current.y = g.ay + g.l1;
+    SolveFK(g, s.theta1, s.theta2, current.x, current.y);
+    current.condition = SolveJacobian(g, current.theta1, current.theta2, current.x, current.y).condition;
+
+    previous = current;
+}
+
+void Simulation::setPath(const std::vector<Vector2>& path, bool loop)
+{
+    size_t n = path.size();
+
+    x.resize(n);
+    y.resize(n);
+    theta1.resize(n);
+    theta2.resize(n);
+    valid.resize(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        x[i] = path[i].x;
+        y[i] = path[i].y;
+    }
+
+    SolveIKBatch(geometry, x.data(), y.data(), (int)n, theta1.data(), theta2.data(), valid.data());
+
+    failures = (int)std::count(valid.begin(), valid.end(), 0);
+
+    // unreachable samples hold the previous reachable pose
+    for (size_t i = 0; i < n; i++)
+    {
+        if (valid[i]) continue;
+
+        theta1[i] = i ? theta1[i - 1] : current.theta1;
+        theta2[i] = i ? theta2[i - 1] : current.theta2;
+    }
+
+    this->loop = loop;
+    pointsPerTick = pathPointsPerTick;
+    progress = 0;
+    last = n ? (double)(n - 1) : 0;
+}
+
+void Simulation::setTrajectory(const Trajectory& traj, bool loop)
+{
+    size_t n = traj.setpoints.size();
+
+    x.resize(n);
+    y.resize(n);
+    theta1.resize(n);
+    theta2.resize(n);
+    valid.assign(n, 1);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const JointSetpoint& sp = traj.setpoints[i];
+
+        x[i] = sp.x;
+        y[i] = sp.y;
+        theta1[i] = sp.theta1;
+        theta2[i] = sp.theta2;
+    }
+
+    failures = traj.ikFailures;
+
+    this->loop = loop;
+    pointsPerTick = traj.dt > 0 ? dt / traj.dt : 1.0;
+    progress = 0;
+    last = n ? (double)(n - 1) : 0;
+}
+
+int Simulation::advance(double seconds, int maxSteps)
+{
+    accumulator += seconds;
+
+    int steps = 0;
+
+    while (accumulator >= dt && steps < maxSteps)
+    {
+        step();
+        accumulator -= dt;
+        steps++;
+    }
+
+    // drop what could not be caught up rather than replaying it later
+    if (steps == maxSteps) accumulator = std::min(accumulator, dt);
+
+    return steps;
+}
+
+void Simulation::step()
+{
+    previous = current;
+    tickCount++;
+
+    if (theta1.empty()) return;
+
+    progress += pointsPerTick;
+
+    if (loop) progress = std::fmod(progress, last + 1);
+    else progress = std::min(progress, last);
+
+    pose(current, progress);
+}
+
+void Simulation::pose(ArmState& s, double at) const
+{
+    size_t n = theta1.size();
+    size_t i = std::min((size_t)at, n - 1);
+    size_t j = loop ? (i + 1) % n : std::min(i + 1, n - 1);
+    float f = (float)(at - i);
+
+    s.theta1 = LerpAngle(theta1[i], theta1[j], f);
+    s.theta2 = LerpAngle(theta2[i], theta2[j], f);
+    s.x = x[i] + (x[j] - x[i]) * f;
+    s.y = y[i] + (y[j] - y[i]) * f;
+
+    SolveFK(geometry, s.theta1, s.theta2, s.x, s.y);
+    s.condition = SolveJacobian(geometry, s.theta1, s.theta2, s.x, s.y).condition;
+}
+
+ArmState Simulation::interpolated() const
+{
+    float alpha = (float)(accumulator / dt);
+
+    ArmState s = current;
+    s.theta1 = LerpAngle(previous.theta1, current.theta1, alpha);
+    s.theta2 = LerpAngle(previous.theta2, current.theta2, alpha);
+    SolveFK(geometry, s.theta1, s.theta2, s.x, s.y);
+    s.condition = SolveJacobian(geometry, s.theta1, s.theta2, s.x, s.y).condition;
+
+    return s;
+}
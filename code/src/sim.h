@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <raylib.h>
+#include "kinematics.h"
+#include "trajectory.h"
+
+struct ArmState
+{
+    float theta1 = 0;
+    float theta2 = 0;
+    float x = 0;    // end effector, from forward kinematics
+    float y = 0;
+    float condition = 1;   // of the jacobian at this pose, see SolveJacobian
+};
+
+// fixed timestep arm simulation. the control loop ticks at a fixed rate
+// no matter how it is driven: advance() banks wall time in an accumulator
+// for the window, step() runs one tick for batch runs. the planned path
+// is played back at pointRate samples per second, a trajectory at its
+// setpoint rate, joints interpolated linearly between samples
+class Simulation
+{
+public:
+    Simulation(const FiveBar& g, double controlHz, double pointRate);
+
+    // solves ik for the whole path up front and restarts playback
+    void setPath(const std::vector<Vector2>& path, bool loop);
+
+    // plays timestamped setpoints at their own rate instead
+    void setTrajectory(const Trajectory& traj, bool loop);
+
+    // runs every whole tick that fits in the accumulated time, at most
+    // maxSteps so a stalled frame cannot snowball. returns ticks run
+    int advance(double seconds, int maxSteps = 250);
+    void step();
+
+    // blend of the last two ticks by the leftover accumulator, for drawing
+    ArmState interpolated() const;
+    const ArmState& state() const { return current; }
+
+    bool finished() const { return !loop && progress >= last; }
+    int ikFailures() const { return failures; }
+    uint64_t ticks() const { return tickCount; }
+    double time() const { return tickCount * dt; }
+    double timestep() const { return dt; }
+
+private:
+    void pose(ArmState& s, double at) const;
+
+    FiveBar geometry;
+    double dt;
+    double pathPointsPerTick;
+    double pointsPerTick;
+
+    std::vector<float> x, y, theta1, theta2;
+    std::vector<uint8_t> valid;
+    int failures = 0;
+
+    bool loop = false;
+    double progress = 0;   // path position in samples
+    double last = 0;
+    double accumulator = 0;
+    uint64_t tickCount = 0;
+
+    ArmState previous, current;
+};
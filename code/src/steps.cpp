@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "steps.h"
+
+const char STEPS_MAGIC[4] = {'5', 'B', 'S', 'T'};
+const uint32_t STEPS_VERSION = 1;
+
+void StepTimeline::reset(float theta1, float theta2)
+{
+    double perRadian = config.stepsPerRadian();
+
+    steps[0] = std::llround(theta1 * perRadian);
+    steps[1] = std::llround(theta2 * perRadian);
+    now = lastEvent = 0;
+    counters = {};
+}
+
+void StepTimeline::emit(uint64_t at, uint8_t step, uint8_t dir, std::vector<StepEvent>& out)
+{
+    uint64_t delay = at - lastEvent;
+
+    while (delay > UINT16_MAX)
+    {
+        out.push_back({UINT16_MAX, 0, dir});
+        delay -= UINT16_MAX;
+        counters.waits++;
+    }
+
+    out.push_back({(uint16_t)delay, step, dir});
+    lastEvent = at;
+    counters.events++;
+}
+
+void StepTimeline::segment(const int64_t target[2], uint64_t end, std::vector<StepEvent>& out)
+{
+    int64_t delta[2] = {target[0] - steps[0], target[1] - steps[1]};
+    int64_t count[2] = {std::llabs(delta[0]), std::llabs(delta[1])};
+    int64_t major = std::max(count[0], count[1]);
+
+    uint64_t start = now;
+    uint64_t span = end - start;
+    now = end;
+
+    if (!major) return;
+
+    uint8_t dir = (delta[0] > 0 ? 1 : 0) | (delta[1] > 0 ? 2 : 0);
+
+    for (int j = 0; j < 2; j++)
+    {
+        counters.steps[j] += count[j];
+        if (span) counters.peakRate[j] = std::max(counters.peakRate[j], count[j] * (double)config.clockHz / span);
+    }
+
+    // the major joint steps in the middle of each of major equal slices,
+    // the minor one when its error passes major, starting half way
+    int64_t error[2] = {major / 2, major / 2};
+
+    for (int64_t i = 0; i < major; i++)
+    {
+        uint8_t step = 0;
+
+        for (int j = 0; j < 2; j++)
+        {
+            error[j] += count[j];
+            if (error[j] >= major)
+            {
+                error[j] -= major;
+                step |= 1 << j;
+            }
+        }
+
+        emit(start + ((2 * i + 1) * span) / (2 * major), step, dir, out);
+    }
+
+    steps[0] = target[0];
+    steps[1] = target[1];
+}
+
+void StepTimeline::append(const Trajectory& traj, std::vector<StepEvent>& out)
+{
+    if (traj.setpoints.empty()) return;
+
+    double perRadian = config.stepsPerRadian();
+    uint64_t period = (uint64_t)std::llround(traj.dt * config.clockHz);
+
+    auto Target = [&](const JointSetpoint& sp, int64_t target[2])
+    {
+        target[0] = std::llround(sp.theta1 * perRadian);
+        target[1] = std::llround(sp.theta2 * perRadian);
+    };
+
+    // the same pose can come a whole turn off from the last trajectory's
+    // end, the joints do not spin round to it
+    int64_t turn = std::llround(6.283185307179586 * perRadian);
+    int64_t first[2], shift[2];
+    Target(traj.setpoints[0], first);
+
+    for (int j = 0; j < 2; j++)
+    {
+        shift[j] = (int64_t)std::llround((double)(steps[j] - first[j]) / turn) * turn;
+        first[j] += shift[j];
+    }
+
+    // a joint not already at the first setpoint gets there in a period
+    if (first[0] != steps[0] || first[1] != steps[1]) segment(first, now + period, out);
+
+    // period ends from the trajectory's own start, so rounding never adds up
+    uint64_t origin = now;
+
+    for (size_t k = 1; k < traj.setpoints.size(); k++)
+    {
+        int64_t target[2];
+        Target(traj.setpoints[k], target);
+        target[0] += shift[0];
+        target[1] += shift[1];
+
+        segment(target, origin + (uint64_t)std::llround(k * traj.dt * config.clockHz), out);
+    }
+}
+
+bool WriteStepStream(const std::string& path, const StepperConfig& c, const std::vector<StepEvent>& events)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    uint32_t header[4];
+    memcpy(&header[0], STEPS_MAGIC, 4);
+    header[1] = STEPS_VERSION;
+    header[2] = c.clockHz;
+    header[3] = (uint32_t)std::lround(c.stepsPerTurn * c.microsteps * c.gear);
+
+    out.write((const char*)header, sizeof(header));
+    out.write((const char*)events.data(), events.size() * sizeof(StepEvent));
+
+    return (bool)out;
+}
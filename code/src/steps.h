@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "trajectory.h"
+
+// a stepper driven joint: full steps a motor turn, the driver's microsteps
+// and the reduction to the joint. step times are counted on a timer of
+// clockHz, the one the step interrupt runs from
+struct StepperConfig
+{
+    int stepsPerTurn;
+    int microsteps;
+    float gear;
+    uint32_t clockHz;
+
+    double stepsPerRadian() const { return stepsPerTurn * microsteps * (double)gear / 6.283185307179586; }
+};
+
+// one entry of the event stream: wait delay timer ticks after the last
+// entry, then pulse the step line of every motor set in step, bit 0 for
+// theta1 and bit 1 for theta2, with the direction lines as in dir, a set
+// bit turning the joint positive. an entry with no steps only waits, for
+// gaps past 16 bits
+struct StepEvent
+{
+    uint16_t delay;
+    uint8_t step;
+    uint8_t dir;
+};
+
+struct StepStats
+{
+    uint64_t steps[2] = {};
+    uint64_t events = 0;
+    uint64_t waits = 0;        // entries that only wait
+    double peakRate[2] = {};   // steps a second, over a control period
+};
+
+// turns joint trajectories into step events. each control period moves
+// every joint to its setpoint rounded to a whole microstep, so position
+// never drifts from the trajectory, and its steps are interleaved
+// bresenham style: the joint with the most steps takes them evenly over
+// the period and the other steps on the ticks its error carries over, so
+// both land in one event where they coincide. times are whole timer ticks
+// counted from the start of the timeline, not from the last event. the
+// events go into a vector the caller keeps, nothing is allocated per step
+class StepTimeline
+{
+public:
+    explicit StepTimeline(const StepperConfig& c) : config(c) {}
+
+    // restarts the clock with the joints at theta, as whole microsteps
+    void reset(float theta1, float theta2);
+
+    // appends traj from the end of the timeline, setpoints at its own dt
+    void append(const Trajectory& traj, std::vector<StepEvent>& out);
+
+    int64_t position(int joint) const { return steps[joint]; }
+    uint64_t ticks() const { return now; }
+    const StepStats& stats() const { return counters; }
+
+private:
+    void segment(const int64_t target[2], uint64_t end, std::vector<StepEvent>& out);
+    void emit(uint64_t at, uint8_t step, uint8_t dir, std::vector<StepEvent>& out);
+
+    StepperConfig config;
+    int64_t steps[2] = {};
+    uint64_t now = 0;         // end of the timeline
+    uint64_t lastEvent = 0;
+    StepStats counters;
+};
+
+// the stream as a file: a 16 byte header of "5BST", version, the timer
+// clock and the microsteps a joint turn, then the 4 byte events
+bool WriteStepStream(const std::string& path, const StepperConfig& c, const std::vector<StepEvent>& events);
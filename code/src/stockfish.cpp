@@ -1,56 +1,386 @@
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include "stockfish.h"
 
 Stockfish sf;
 
-bool Stockfish::start(const std::string& path)
+const int ENGINE_HANDSHAKE_MS = 5000;
+const int ENGINE_GRACE_MS = 1000;
+const int ENGINE_QUIT_MS = 500;
+const int ENGINE_WRITE_MS = 1000;
+
+// longest line the reader keeps, the rest of a longer one is dropped. the
+// fields it parses all come early in the line
+const size_t ENGINE_LINE_MAX = 1024;
+
+// a word of the line being parsed, pointing into it
+struct Token
 {
-    engine = popen(path.c_str(), "r+");
-    if (!engine) return false;
+    const char* text = nullptr;
+    size_t size = 0;
+
+    bool is(const char* word) const { return size == strlen(word) && !memcmp(text, word, size); }
+};
+
+static void CopyToken(char* dst, Token src)
+{
+    size_t n = std::min(src.size, (size_t)5);
+    memcpy(dst, src.text, n);
+    dst[n] = '\0';
+}
+
+static int TokenInt(Token t)
+{
+    char digits[16];
+    size_t n = std::min(t.size, sizeof(digits) - 1);
+    memcpy(digits, t.text, n);
+    digits[n] = '\0';
+
+    return atoi(digits);
+}
+
+// words are read in place, so parsing allocates nothing
+static bool ParseLine(const char* line, size_t size, EngineEvent& ev)
+{
+    ev = {};
+
+    auto Starts = [&](const char* word) { return size >= strlen(word) && !memcmp(line, word, strlen(word)); };
+
+    if (Starts("uciok")) { ev.type = EngineEventType::UciOk; return true; }
+    if (Starts("readyok")) { ev.type = EngineEventType::ReadyOk; return true; }
+
+    bool best = Starts("bestmove");
+    bool info = Starts("info");
+
+    if (!best && !info) return false;
+
+    ev.type = best ? EngineEventType::BestMove : EngineEventType::Info;
+
+    size_t pos = 0;
+    Token key, token;
+
+    auto next = [&](Token& out)
+    {
+        while (pos < size && line[pos] == ' ') pos++;
+        size_t start = pos;
+        while (pos < size && line[pos] != ' ') pos++;
+        out = {line + start, pos - start};
+        return out.size > 0;
+    };
+
+    next(key);
+
+    while (next(key))
+    {
+        if (best)
+        {
+            if (!ev.move[0]) CopyToken(ev.move, key);
+            else if (key.is("ponder") && next(token)) CopyToken(ev.ponder, token);
+        }
+        else if (key.is("depth") && next(token)) ev.depth = TokenInt(token);
+        else if (key.is("score") && next(token))
+        {
+            ev.mate = token.is("mate");
+            if (next(token)) ev.score = TokenInt(token);
+        }
+        else if (key.is("pv"))
+        {
+            if (next(token)) CopyToken(ev.move, token);
+            if (next(token)) CopyToken(ev.ponder, token);
+            break;
+        }
+        else if (key.is("string")) break;
+    }
+
+    return true;
+}
+
+Stockfish::~Stockfish()
+{
+    stop();
+}
+
+bool Stockfish::start(const std::string& path, const std::vector<std::string>& args)
+{
+    if (started || !proc.spawn(path, args)) return false;
+
+    started = true;
+    alive = true;
+
+    reader = std::thread(&Stockfish::readLoop, this);
+    writer = std::thread(&Stockfish::writeLoop, this);
 
     send("uci");
-    readUntil("uciok");
+    if (!waitFor(EngineEventType::UciOk, ENGINE_HANDSHAKE_MS)) { stop(); return false; }
 
     send("isready");
-    readUntil("readyok");
+    if (!waitFor(EngineEventType::ReadyOk, ENGINE_HANDSHAKE_MS)) { stop(); return false; }
 
     return true;
 }
 
 void Stockfish::stop()
 {
-    if (engine)
+    if (!started) return;
+
+    send("quit");
+
     {
-        pclose(engine);
-        engine = nullptr;
+        std::lock_guard<std::mutex> lock(queueMutex);
+        alive = false;
     }
+    queueCv.notify_all();
+
+    if (writer.joinable()) writer.join();
+    if (reader.joinable()) reader.join();
+
+    proc.terminate(ENGINE_QUIT_MS);
+    started = false;
+
+    events.clear();
+    stale = 0;
+    if (search == SearchState::Thinking || search == SearchState::Stopping) search = SearchState::Failed;
 }
 
 void Stockfish::send(const std::string& cmd)
 {
-    if (!engine) return;
+    if (!started) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        commands.push_back(cmd);
+    }
+    queueCv.notify_one();
+}
+
+EngineFuture Stockfish::go(const std::string& position, int movetime, bool ponder)
+{
+    poll();
+
+    if (!alive || search == SearchState::Thinking) return {};
+
+    // a stopped search still owes its bestmove. the engine answers in
+    // order, so the new search goes out behind the stop and that one is
+    // skipped when it comes
+    if (search == SearchState::Stopping) stale++;
+
+    current = {};
+    search = SearchState::Thinking;
+    discard = false;
+    searchMs = movetime;
+    this->ponder = ponder;
+    deadline = Clock::now() + std::chrono::milliseconds(movetime + ENGINE_GRACE_MS);
+
+    send(position);
+    send(std::string(ponder ? "go ponder movetime " : "go movetime ") + std::to_string(movetime));
+
+    EngineFuture f;
+    f.engine = this;
+    f.id = ++searchId;
+
+    return f;
+}
+
+void Stockfish::ponderHit()
+{
+    if (search != SearchState::Thinking || !ponder) return;
+
+    // movetime counts from here
+    send("ponderhit");
+    ponder = false;
+    deadline = Clock::now() + std::chrono::milliseconds(searchMs + ENGINE_GRACE_MS);
+}
+
+void Stockfish::stopSearch()
+{
+    if (search != SearchState::Thinking) return;
+
+    send("stop");
+    ponder = false;
+    search = SearchState::Stopping;
+    deadline = Clock::now() + std::chrono::milliseconds(ENGINE_GRACE_MS);
+}
+
+void Stockfish::poll()
+{
+    EngineEvent ev;
+
+    while (events.pop(ev))
+    {
+        bool active = search == SearchState::Thinking || search == SearchState::Stopping;
+
+        switch (ev.type)
+        {
+        case EngineEventType::Info:
+            if (!active || stale) break;
+            if (ev.depth) current.depth = ev.depth;
+            if (ev.move[0])
+            {
+                current.pv = ev.move;
+                current.score = ev.score;
+                current.mate = ev.mate;
+            }
+            break;
+
+        case EngineEventType::BestMove:
+            if (stale)
+            {
+                stale--;
+                break;
+            }
+
+            if (!active) break;
+            current.bestmove = ev.move;
+            current.ponder = ev.ponder;
+            search = discard ? SearchState::Idle : SearchState::Done;
+            ponder = false;
+            break;
+
+        case EngineEventType::Eof:
+            if (active) search = SearchState::Failed;
+            break;
 
-    fprintf(engine, "%s\n", cmd.c_str());
-    fflush(engine);
+        default:
+            break;
+        }
+    }
+
+    // a ponder search has no deadline until it is hit
+    if (((search == SearchState::Thinking && !ponder) || search == SearchState::Stopping) && Clock::now() > deadline)
+    {
+        if (search == SearchState::Thinking) stopSearch();
+        else search = SearchState::Failed;
+    }
 }
 
-std::string Stockfish::readLine()
+bool Stockfish::waitFor(EngineEventType type, int timeoutMs)
 {
-    if (!engine) return "";
+    Clock::time_point end = Clock::now() + std::chrono::milliseconds(timeoutMs);
 
-    char buffer[512];
-    if (fgets(buffer, sizeof(buffer), engine)) return std::string(buffer);
+    while (Clock::now() < end)
+    {
+        EngineEvent ev;
+
+        while (events.pop(ev))
+        {
+            if (ev.type == type) return true;
+            if (ev.type == EngineEventType::Eof) return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 
-    return "";
+    return false;
 }
 
-std::string Stockfish::readUntil(const std::string& token)
+void Stockfish::pushEvent(const EngineEvent& ev)
 {
-    std::string line;
+    // info lines may be dropped under pressure, everything else must arrive
+    if (events.push(ev) || ev.type == EngineEventType::Info) return;
+
+    while (alive && !events.push(ev)) std::this_thread::yield();
+}
+
+void Stockfish::readLoop()
+{
+    char chunk[4096];
+    char line[ENGINE_LINE_MAX];
+    size_t length = 0;
+    EngineEvent ev;
+
+    while (alive)
+    {
+        int r = proc.waitReadable(100);
+        if (r == 0) continue;
+        if (r < 0) break;
+
+        ssize_t n = proc.read(chunk, sizeof(chunk));
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n <= 0) break;
+
+        for (ssize_t i = 0; i < n; i++)
+        {
+            char c = chunk[i];
+
+            if (c == '\n')
+            {
+                if (ParseLine(line, length, ev)) pushEvent(ev);
+                length = 0;
+            }
+            else if (c != '\r' && length < ENGINE_LINE_MAX) line[length++] = c;
+        }
+    }
+
+    ev = {};
+    ev.type = EngineEventType::Eof;
+    pushEvent(ev);
+}
+
+void Stockfish::writeLoop()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
 
     while (true)
     {
-        line = readLine();
-        if (line.find(token) != std::string::npos) return line;
+        queueCv.wait(lock, [&] { return !commands.empty() || !alive; });
+        if (commands.empty()) return;
+
+        std::string cmd = std::move(commands.front());
+        commands.pop_front();
+        lock.unlock();
+
+        cmd += '\n';
+        proc.writeAll(cmd.data(), cmd.size(), ENGINE_WRITE_MS);
+
+        lock.lock();
     }
-}
\ No newline at end of file
+}
+
+bool EngineFuture::ready() const
+{
+    if (!engine) return false;
+
+    engine->poll();
+
+    if (id != engine->searchId) return true;
+
+    return engine->search == SearchState::Done || engine->search == SearchState::Failed || engine->discard;
+}
+
+bool EngineFuture::failed() const
+{
+    if (!engine || id != engine->searchId || engine->discard) return true;
+
+    return engine->search == SearchState::Failed;
+}
+
+const EngineResult& EngineFuture::get() const
+{
+    return engine->current;
+}
+
+void EngineFuture::stop()
+{
+    if (engine && id == engine->searchId) engine->stopSearch();
+}
+
+void EngineFuture::ponderHit()
+{
+    if (engine && id == engine->searchId) engine->ponderHit();
+}
+
+bool EngineFuture::pondering() const
+{
+    return engine && id == engine->searchId && engine->ponder && engine->search == SearchState::Thinking;
+}
+
+void EngineFuture::cancel()
+{
+    if (!engine || id != engine->searchId) return;
+
+    engine->stopSearch();
+    engine->discard = true;
+}
@@ -1,19 +1,133 @@
 #pragma once
-#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+#include "process.h"
+#include "ring.h"
+
+enum class EngineEventType
+{
+    Info,
+    BestMove,
+    UciOk,
+    ReadyOk,
+    Eof
+};
+
+// parsed engine output. plain data, and lines are read into a fixed buffer
+// and parsed in place, so the reader thread never allocates
+struct EngineEvent
+{
+    EngineEventType type = EngineEventType::Info;
+    int depth = 0;
+    int score = 0;
+    bool mate = false;
+    char move[6] = {};
+    char ponder[6] = {};
+};
+
+struct EngineResult
+{
+    std::string bestmove;
+    std::string ponder;
+    std::string pv;
+    int depth = 0;
+    int score = 0;
+    bool mate = false;
+};
+
+enum class SearchState
+{
+    Idle,
+    Thinking,
+    Stopping,
+    Done,
+    Failed
+};
+
+class Stockfish;
+
+// handle to a running search, polled once per frame
+class EngineFuture
+{
+public:
+    bool valid() const { return engine != nullptr; }
+    bool ready() const;
+    bool failed() const;
+    const EngineResult& get() const;
+
+    void stop();
+    void cancel();
+
+    // the move pondered on was played, the search goes on as a normal one
+    void ponderHit();
+    bool pondering() const;
+
+private:
+    friend class Stockfish;
+
+    Stockfish* engine = nullptr;
+    unsigned id = 0;
+};
 
 class Stockfish
 {
 public:
-    bool start(const std::string& path);
+    ~Stockfish();
+
+    bool start(const std::string& path, const std::vector<std::string>& args = {});
     void stop();
 
     void send(const std::string& cmd);
-    std::string readLine();
-    std::string readUntil(const std::string& token);
+
+    // with ponder the position ends in the move the engine expects, and
+    // the search runs without a deadline until ponderHit or stop. a search
+    // still stopping is queued behind, not refused. an invalid future when
+    // the engine is not running or another search is thinking
+    EngineFuture go(const std::string& position, int movetime, bool ponder = false);
+    void ponderHit();
+    void stopSearch();
+    void poll();
+
+    bool running() const { return alive.load(); }
+    SearchState state() const { return search; }
 
 private:
-    FILE* engine = nullptr;
+    friend class EngineFuture;
+
+    using Clock = std::chrono::steady_clock;
+
+    bool waitFor(EngineEventType type, int timeoutMs);
+    void readLoop();
+    void writeLoop();
+    void pushEvent(const EngineEvent& ev);
+
+    Process proc;
+    bool started = false;
+
+    std::atomic<bool> alive{false};
+    std::thread reader;
+    std::thread writer;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<std::string> commands;
+
+    SpscRing<EngineEvent, 256> events;
+
+    SearchState search = SearchState::Idle;
+    EngineResult current;
+    Clock::time_point deadline;
+    int searchMs = 0;
+    bool ponder = false;
+    unsigned searchId = 0;
+    bool discard = false;
+    int stale = 0;   // bestmoves still owed by stopped searches a new one went out behind
 };
 
-extern Stockfish sf;  
\ No newline at end of file
+extern Stockfish sf;
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.h"
+#include "pool.h"
+#include "route.h"
+
+TrajectoryTable trajectoryTable;
+
+const char TABLE_MAGIC[4] = {'5', 'B', 'T', 'T'};
+// 2: retimed slower through near singular poses
+const uint32_t TABLE_VERSION = 2;
+
+const double TWO_PI = 6.283185307179586;
+
+struct TableHeader
+{
+    char magic[4];
+    uint32_t version;
+    FiveBar geometry;
+    int32_t squareSize, offsetX, offsetY;
+    MotorLimits limits;
+    double dt;
+    int32_t counts, cells;
+    uint64_t nodeOffset, nodeCount;       // bytes from the start of the file, entries
+    uint64_t sampleOffset, sampleCount;
+};
+
+// one per ordered pair of cells, from major. nodes == 0 when there is no route
+struct TrajectoryTable::Pair
+{
+    uint32_t node;
+    uint32_t sample;
+    uint32_t samples;
+    uint16_t nodes;
+    uint16_t ikFailures;
+    float duration;
+    float peakVelocity, peakAcceleration, peakJerk;
+};
+
+// lattice corners of the route, see LatticePoint
+struct TableNode
+{
+    int8_t c, r;
+};
+
+// joint angles in encoder counts, wrapped to +-half a turn, and the
+// planned position in eighths of a pixel. near the forward singularity a
+// count moves the end effector by pixels, so it is not recovered by fk
+struct TableSample
+{
+    int16_t theta1, theta2;
+    int16_t x, y;
+};
+
+const float POSITION_SCALE = 8.0f;
+
+// squares 0..63, then the graveyard slots file by file. the spare cells
+// past the ends of the files are left to the router
+static int CellIndex(Cell c)
+{
+    if (c.rank < 0 || c.rank > 7) return -1;
+    if (c.file >= 0 && c.file < 8) return MakeSquare(c.file, c.rank);
+
+    int i = c.file == -2 ? 0 : c.file == -1 ? 1 : c.file == 8 ? 2 : c.file == 9 ? 3 : -1;
+
+    return i < 0 ? -1 : 64 + 8 * i + c.rank;
+}
+
+static Cell IndexCell(int i)
+{
+    if (i < 64) return SquareCell(i);
+
+    static const int FILES[4] = {-2, -1, 8, 9};
+
+    return {FILES[(i - 64) / 8], (i - 64) % 8};
+}
+
+static bool Matches(const TableHeader& h, const FiveBar& g, const MotorLimits& limits, double dt)
+{
+    return !memcmp(h.magic, TABLE_MAGIC, 4) && h.version == TABLE_VERSION && !memcmp(&h.geometry, &g, sizeof(FiveBar)) &&
+           h.squareSize == squareSize && h.offsetX == offsetX && h.offsetY == offsetY &&
+           !memcmp(&h.limits, &limits, sizeof(MotorLimits)) && h.dt == dt && h.counts == ENCODER_COUNTS &&
+           h.cells == TABLE_CELLS;
+}
+
+bool TrajectoryTable::open(const std::string& path, const FiveBar& g, const MotorLimits& limits, double dt)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(TableHeader))
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if (map == MAP_FAILED) return false;
+
+    const TableHeader* h = (const TableHeader*)map;
+    size_t size = st.st_size;
+    size_t pairs = sizeof(TableHeader) + (size_t)TABLE_CELLS * TABLE_CELLS * sizeof(Pair);
+
+    bool ok = Matches(*h, g, limits, dt) && size >= pairs &&
+              h->nodeOffset + h->nodeCount * sizeof(TableNode) <= size &&
+              h->sampleOffset + h->sampleCount * sizeof(TableSample) <= size;
+
+    // every pair's nodes and samples inside their sections, so a truncated
+    // or corrupt file is turned away here rather than read past on lookup
+    const Pair* p = (const Pair*)((const unsigned char*)map + sizeof(TableHeader));
+
+    for (int i = 0; ok && i < TABLE_CELLS * TABLE_CELLS; i++)
+        ok = (uint64_t)p[i].node + p[i].nodes <= h->nodeCount && (uint64_t)p[i].sample + p[i].samples <= h->sampleCount;
+
+    if (!ok)
+    {
+        munmap(map, size);
+        return false;
+    }
+
+    base = (const unsigned char*)map;
+    length = size;
+
+    return true;
+}
+
+void TrajectoryTable::close()
+{
+    if (base) munmap((void*)base, length);
+
+    base = nullptr;
+    length = 0;
+}
+
+const TrajectoryTable::Pair* TrajectoryTable::pair(Cell from, Cell to) const
+{
+    int i = CellIndex(from), j = CellIndex(to);
+    if (!base || i < 0 || j < 0) return nullptr;
+
+    const Pair* p = (const Pair*)(base + sizeof(TableHeader)) + i * TABLE_CELLS + j;
+
+    // pairs the arm cannot follow are kept in the file but never served
+    return p->nodes && !p->ikFailures ? p : nullptr;
+}
+
+bool TrajectoryTable::route(Cell from, Cell to, Bitboard occupied, uint64_t offBoard, std::vector<Vector2>& path) const
+{
+    const Pair* p = pair(from, to);
+    if (!p) return false;
+
+    const TableHeader* h = (const TableHeader*)base;
+    const TableNode* nodes = (const TableNode*)(base + h->nodeOffset) + p->node;
+
+    // the ends are the mover's own cell and its target
+    Bitboard blocked = occupied;
+    if (CellIndex(from) < 64) blocked &= ~SquareBit(CellIndex(from));
+    if (CellIndex(to) < 64) blocked &= ~SquareBit(CellIndex(to));
+
+    uint64_t graves = offBoard & ~GraveyardBit(from) & ~GraveyardBit(to);
+
+    // walk every half square step, the same test the router makes
+    for (int i = 1; i < p->nodes; i++)
+    {
+        int c = nodes[i - 1].c, r = nodes[i - 1].r;
+        int dc = (nodes[i].c > c) - (nodes[i].c < c), dr = (nodes[i].r > r) - (nodes[i].r < r);
+
+        while (c != nodes[i].c || r != nodes[i].r)
+        {
+            Cell q;
+            if (StepSquare(c, r, dc, dr, q))
+            {
+                int k = CellIndex(q);
+
+                if (k >= 0 && k < 64 && (blocked & SquareBit(k))) return false;
+                if (graves & GraveyardBit(q)) return false;
+            }
+
+            c += dc;
+            r += dr;
+        }
+    }
+
+    path.clear();
+    for (int i = 0; i < p->nodes; i++) path.push_back(LatticePoint(nodes[i].c, nodes[i].r));
+
+    return true;
+}
+
+bool TrajectoryTable::trajectory(Cell from, Cell to, Trajectory& out) const
+{
+    const Pair* p = pair(from, to);
+    if (!p) return false;
+
+    const TableHeader* h = (const TableHeader*)base;
+    const TableSample* samples = (const TableSample*)(base + h->sampleOffset) + p->sample;
+
+    out = {};
+    out.dt = h->dt;
+    out.duration = p->duration;
+    out.ikFailures = p->ikFailures;
+    out.peakVelocity = p->peakVelocity;
+    out.peakAcceleration = p->peakAcceleration;
+    out.peakJerk = p->peakJerk;
+    out.setpoints.resize(p->samples);
+
+    for (uint32_t k = 0; k < p->samples; k++)
+    {
+        JointSetpoint& sp = out.setpoints[k];
+        sp.t = (float)(k * h->dt);
+        sp.theta1 = (float)EncoderAngle(samples[k].theta1);
+        sp.theta2 = (float)EncoderAngle(samples[k].theta2);
+
+        // unwrap across the seam the counts wrapped at
+        if (k)
+        {
+            const JointSetpoint& last = out.setpoints[k - 1];
+            sp.theta1 = last.theta1 + (float)std::remainder(sp.theta1 - last.theta1, TWO_PI);
+            sp.theta2 = last.theta2 + (float)std::remainder(sp.theta2 - last.theta2, TWO_PI);
+        }
+
+        sp.x = samples[k].x / POSITION_SCALE;
+        sp.y = samples[k].y / POSITION_SCALE;
+    }
+
+    // rest at both ends, central differences between
+    for (uint32_t k = 1; k + 1 < p->samples; k++)
+    {
+        JointSetpoint& sp = out.setpoints[k];
+        sp.omega1 = (float)((out.setpoints[k + 1].theta1 - out.setpoints[k - 1].theta1) / (2 * h->dt));
+        sp.omega2 = (float)((out.setpoints[k + 1].theta2 - out.setpoints[k - 1].theta2) / (2 * h->dt));
+    }
+
+    return true;
+}
+
+bool TrajectoryTable::build(const std::string& path, const FiveBar& g, const MotorLimits& limits, double dt, int threads)
+{
+    struct Row
+    {
+        std::vector<Pair> pairs;
+        std::vector<TableNode> nodes;
+        std::vector<TableSample> samples;
+    };
+
+    std::vector<Row> rows(TABLE_CELLS);
+
+    {
+        TaskPool pool(threads);
+
+        for (int i = 0; i < TABLE_CELLS; i++)
+        {
+            pool.submit([&, i]
+            {
+                Router router(g);
+                Row& row = rows[i];
+                std::vector<Vector2> route;
+
+                row.pairs.assign(TABLE_CELLS, Pair{});
+
+                for (int j = 0; j < TABLE_CELLS; j++)
+                {
+                    // nothing is carried from one slot to another
+                    if (i == j || (i >= 64 && j >= 64)) continue;
+                    if (!router.route(0, 0, IndexCell(i), IndexCell(j), route)) continue;
+
+                    Trajectory traj = LegTrajectory(g, route, limits, dt);
+
+                    Pair& p = row.pairs[j];
+                    p.node = (uint32_t)row.nodes.size();
+                    p.nodes = (uint16_t)route.size();
+                    p.sample = (uint32_t)row.samples.size();
+                    p.samples = (uint32_t)traj.setpoints.size();
+                    p.ikFailures = (uint16_t)std::min(traj.ikFailures, 65535);
+                    p.duration = (float)traj.duration;
+                    p.peakVelocity = traj.peakVelocity;
+                    p.peakAcceleration = traj.peakAcceleration;
+                    p.peakJerk = traj.peakJerk;
+
+                    for (const Vector2& v : route)
+                    {
+                        int c = (int)std::lround(((v.x - offsetX) / squareSize - ROUTE_FILE_LO) * 2);
+                        int r = (int)std::lround(((v.y - offsetY) / squareSize - ROUTE_RANK_LO) * 2);
+                        row.nodes.push_back({(int8_t)c, (int8_t)r});
+                    }
+
+                    for (const JointSetpoint& sp : traj.setpoints) row.samples.push_back({EncoderCounts(sp.theta1), EncoderCounts(sp.theta2),
+                                                (int16_t)std::lround(sp.x * POSITION_SCALE),
+                                                (int16_t)std::lround(sp.y * POSITION_SCALE)});
+                }
+            });
+        }
+
+        pool.wait();
+    }
+
+    // rows were numbered from zero each, move them to their place in the file
+    std::vector<Pair> pairs;
+    std::vector<TableNode> nodes;
+    std::vector<TableSample> samples;
+
+    pairs.reserve((size_t)TABLE_CELLS * TABLE_CELLS);
+
+    for (Row& row : rows)
+    {
+        for (Pair& p : row.pairs)
+        {
+            if (!p.nodes) continue;
+
+            p.node += (uint32_t)nodes.size();
+            p.sample += (uint32_t)samples.size();
+        }
+
+        pairs.insert(pairs.end(), row.pairs.begin(), row.pairs.end());
+        nodes.insert(nodes.end(), row.nodes.begin(), row.nodes.end());
+        samples.insert(samples.end(), row.samples.begin(), row.samples.end());
+    }
+
+    TableHeader h = {};
+    memcpy(h.magic, TABLE_MAGIC, 4);
+    h.version = TABLE_VERSION;
+    h.geometry = g;
+    h.squareSize = squareSize;
+    h.offsetX = offsetX;
+    h.offsetY = offsetY;
+    h.limits = limits;
+    h.dt = dt;
+    h.counts = ENCODER_COUNTS;
+    h.cells = TABLE_CELLS;
+    h.nodeOffset = sizeof(TableHeader) + pairs.size() * sizeof(Pair);
+    h.nodeCount = nodes.size();
+
+    // samples start 4 byte aligned
+    h.sampleOffset = (h.nodeOffset + nodes.size() * sizeof(TableNode) + 3) & ~(uint64_t)3;
+    h.sampleCount = samples.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    char pad[4] = {};
+
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)pairs.data(), pairs.size() * sizeof(Pair));
+    out.write((const char*)nodes.data(), nodes.size() * sizeof(TableNode));
+    out.write(pad, h.sampleOffset - (h.nodeOffset + nodes.size() * sizeof(TableNode)));
+    out.write((const char*)samples.data(), samples.size() * sizeof(TableSample));
+
+    return (bool)out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <raylib.h>
+#include "board.h"
+#include "kinematics.h"
+#include "plan.h"
+#include "trajectory.h"
+
+// the 64 squares and the 32 graveyard slots
+const int TABLE_CELLS = 96;
+
+// free board route and trajectory for every pair of cells, solved offline
+// by 5bar_table and mapped read only at startup. a leg whose free board
+// route is still clear of pieces skips the router and the retimer. the
+// file is only used when it was built for the same arm, board placement,
+// limits and control rate
+class TrajectoryTable
+{
+public:
+    TrajectoryTable() = default;
+    ~TrajectoryTable() { close(); }
+
+    TrajectoryTable(const TrajectoryTable&) = delete;
+    TrajectoryTable& operator=(const TrajectoryTable&) = delete;
+
+    // false when the file is missing, damaged or was built for something
+    // else
+    bool open(const std::string& path, const FiveBar& g, const MotorLimits& limits, double dt);
+    void close();
+
+    bool loaded() const { return base != nullptr; }
+
+    // the free board route from from to to, false when there is none,
+    // the arm cannot follow its trajectory, or a piece or taken slot
+    // other than the ones at its ends is in its way
+    bool route(Cell from, Cell to, Bitboard occupied, uint64_t offBoard, std::vector<Vector2>& path) const;
+
+    // the trajectory along that route, decoded at the control rate
+    bool trajectory(Cell from, Cell to, Trajectory& out) const;
+
+    // solves every pair on a pool of threads and writes the file
+    static bool build(const std::string& path, const FiveBar& g, const MotorLimits& limits, double dt, int threads);
+
+    size_t bytes() const { return length; }
+
+private:
+    struct Pair;
+
+    const Pair* pair(Cell from, Cell to) const;
+
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+};
+
+extern TrajectoryTable trajectoryTable;
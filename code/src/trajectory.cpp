@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <cmath>
+#include "trajectory.h"
+#include "cache.h"
+#include "table.h"
+
+// arc length between path samples, board units
+const float SAMPLE_SPACING = 0.5f;
+
+const int LIMIT_ROUNDS = 8;
+
+// turns sharper than this, about 10 degrees, stop the arm
+const float CORNER_COS = 0.985f;
+
+// jacobian condition number past which the path speed is scaled down by
+// CONDITION_SLOW / condition, to no less than CONDITION_FLOOR of it. the
+// forward singular curve runs across the middle of the board, and there
+// a count of either motor moves C by pixels, so C goes through it slower
+// than the joint limits alone would allow
+const float CONDITION_SLOW = 20.0f;
+const float CONDITION_FLOOR = 0.4f;
+
+struct PathSamples
+{
+    double step = 0;
+    std::vector<float> x, y;
+
+    // double, the angles get differentiated twice and float noise there
+    // turns into jerk near singular poses where the path speed is high
+    std::vector<double> theta[2];
+    std::vector<double> d1[2];   // dtheta/ds at each sample
+    std::vector<double> d2[2];   // d2theta/ds2, the spline's second derivative
+    std::vector<float> condition;
+};
+
+static void Resample(const std::vector<Vector2>& waypoints, PathSamples& p)
+{
+    double length = 0;
+    for (size_t i = 1; i < waypoints.size(); i++)
+        length += std::hypot(waypoints[i].x - waypoints[i - 1].x, waypoints[i].y - waypoints[i - 1].y);
+
+    int n = std::max(2, (int)std::ceil(length / SAMPLE_SPACING) + 1);
+    p.step = length / (n - 1);
+    p.x.resize(n);
+    p.y.resize(n);
+
+    size_t seg = 0;
+    double segStart = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        double s = std::min(i * (double)p.step, length);
+
+        // walk forward to the waypoint segment holding s
+        while (seg + 2 < waypoints.size())
+        {
+            double l = std::hypot(waypoints[seg + 1].x - waypoints[seg].x, waypoints[seg + 1].y - waypoints[seg].y);
+            if (segStart + l >= s) break;
+
+            segStart += l;
+            seg++;
+        }
+
+        Vector2 a = waypoints[seg];
+        Vector2 b = waypoints[std::min(seg + 1, waypoints.size() - 1)];
+        double l = std::hypot(b.x - a.x, b.y - a.y);
+        float f = l > 1e-9 ? (float)std::clamp((s - segStart) / l, 0.0, 1.0) : 0.0f;
+
+        p.x[i] = a.x + (b.x - a.x) * f;
+        p.y[i] = a.y + (b.y - a.y) * f;
+    }
+}
+
+static int SolveSamples(const FiveBar& g, PathSamples& p)
+{
+    int n = (int)p.x.size();
+    std::vector<uint8_t> valid(n);
+
+    for (int j = 0; j < 2; j++)
+    {
+        p.theta[j].resize(n);
+        p.d1[j].resize(n);
+        p.d2[j].resize(n);
+    }
+
+    for (int i = 0; i < n; i++) valid[i] = SolveIKPrecise(g, p.x[i], p.y[i], p.theta[0][i], p.theta[1][i]);
+
+    int failures = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            // hold the last reachable pose and unwrap across the +-pi seam
+            if (!valid[i]) p.theta[j][i] = i ? p.theta[j][i - 1] : p.theta[j][i];
+            else if (i) p.theta[j][i] = p.theta[j][i - 1] + std::remainder(p.theta[j][i] - p.theta[j][i - 1], 6.283185307179586);
+        }
+
+        if (!valid[i]) failures++;
+    }
+
+    std::vector<float> t1(n), t2(n);
+    for (int i = 0; i < n; i++)
+    {
+        t1[i] = (float)p.theta[0][i];
+        t2[i] = (float)p.theta[1][i];
+    }
+
+    p.condition.resize(n);
+    ConditionBatch(g, t1.data(), t2.data(), p.x.data(), p.y.data(), n, p.condition.data());
+
+    // natural cubic spline through each joint, so the joint acceleration
+    // is continuous and the jerk finite between samples
+    double h = p.step;
+    std::vector<double> c(n), r(n);
+
+    for (int j = 0; j < 2; j++)
+    {
+        const std::vector<double>& t = p.theta[j];
+        std::vector<double>& m = p.d2[j];
+
+        m[0] = m[n - 1] = 0;
+
+        // m[i-1] + 4 m[i] + m[i+1] = 6 (t[i+1] - 2 t[i] + t[i-1]) / h^2, thomas algorithm
+        for (int i = 1; i < n - 1; i++)
+        {
+            double rhs = 6.0 * (t[i + 1] - 2.0 * t[i] + t[i - 1]) / (h * h);
+            double den = 4.0 - (i > 1 ? c[i - 1] : 0.0);
+
+            c[i] = 1.0 / den;
+            r[i] = (rhs - (i > 1 ? r[i - 1] : 0.0)) / den;
+        }
+
+        for (int i = n - 2; i >= 1; i--) m[i] = r[i] - c[i] * (i + 1 < n - 1 ? m[i + 1] : 0.0);
+
+        for (int i = 0; i < n - 1; i++) p.d1[j][i] = (t[i + 1] - t[i]) / h - h * (2 * m[i] + m[i + 1]) / 6;
+        p.d1[j][n - 1] = (t[n - 1] - t[n - 2]) / h + h * (m[n - 2] + 2 * m[n - 1]) / 6;
+    }
+
+    return failures;
+}
+
+struct Profile
+{
+    std::vector<double> x;   // path speed squared at each sample
+    std::vector<double> u;   // path acceleration over each segment
+    std::vector<double> t;   // time at each sample
+};
+
+// range of path acceleration at sample i and speed squared x that keeps
+// every joint inside its acceleration limit, false when there is none
+static bool AccelRange(const PathSamples& p, int i, double x, double limit, double& lo, double& hi)
+{
+    lo = -1e30;
+    hi = 1e30;
+
+    for (int j = 0; j < 2; j++)
+    {
+        double a = p.d1[j][i];
+        double b = p.d2[j][i] * x;
+
+        if (std::fabs(a) < 1e-9)
+        {
+            if (std::fabs(b) > limit) return false;
+            continue;
+        }
+
+        double u1 = (-limit - b) / a;
+        double u2 = (limit - b) / a;
+
+        lo = std::max(lo, std::min(u1, u2));
+        hi = std::min(hi, std::max(u1, u2));
+    }
+
+    return lo <= hi;
+}
+
+static void SolveProfile(const PathSamples& p, const MotorLimits& limits, Profile& out)
+{
+    int n = (int)p.x.size();
+    double h = p.step;
+
+    // speed cap from the velocity limit, and from the third of the jerk
+    // limit the averaging leaves to the path terms. the d3theta/ds3 s'^3
+    // term grows where a blend tightens, so it caps the speed there
+    std::vector<double> cap(n);
+    for (int i = 0; i < n; i++)
+    {
+        double d = std::max(std::fabs(p.d1[0][i]), std::fabs(p.d1[1][i]));
+        cap[i] = d > 1e-9 ? (limits.velocity / d) * (limits.velocity / d) : 1e12;
+
+        int k = std::min(i, n - 2);
+        double d3 = std::max(std::fabs(p.d2[0][k + 1] - p.d2[0][k]), std::fabs(p.d2[1][k + 1] - p.d2[1][k])) / h;
+        if (d3 > 1e-9) cap[i] = std::min(cap[i], std::pow(limits.jerk / 3 / d3, 2.0 / 3.0));
+
+        double slow = std::max(CONDITION_FLOOR, std::min(1.0f, CONDITION_SLOW / p.condition[i]));
+        cap[i] *= slow * slow;
+    }
+
+    // backward pass: the largest speed at i from which sample i + 1 stays reachable
+    std::vector<double> reach(n);
+    reach[n - 1] = 0;
+
+    for (int i = n - 2; i >= 0; i--)
+    {
+        double limit = limits.acceleration;
+
+        auto Feasible = [&](double x)
+        {
+            double lo, hi;
+            if (!AccelRange(p, i, x, limit, lo, hi)) return false;
+
+            return lo <= (reach[i + 1] - x) / (2 * h) && hi >= -x / (2 * h);
+        };
+
+        if (Feasible(cap[i])) reach[i] = cap[i];
+        else
+        {
+            double a = 0, b = cap[i];
+            for (int k = 0; k < 50; k++)
+            {
+                double m = (a + b) / 2;
+                (Feasible(m) ? a : b) = m;
+            }
+
+            reach[i] = a;
+        }
+    }
+
+    // forward pass: as hard as the limits and the reachable speeds allow
+    out.x.assign(n, 0);
+    out.u.assign(n, 0);
+    out.t.assign(n, 0);
+
+    for (int i = 0; i < n - 1; i++)
+    {
+        double lo, hi;
+        AccelRange(p, i, out.x[i], limits.acceleration, lo, hi);
+
+        double u = std::min(hi, (reach[i + 1] - out.x[i]) / (2 * h));
+        out.u[i] = u;
+        out.x[i + 1] = std::max(0.0, out.x[i] + 2 * u * h);
+
+        double v = std::sqrt(out.x[i]) + std::sqrt(out.x[i + 1]);
+        double dt = v > 1e-12 ? 2 * h / v : std::sqrt(2 * h / std::max(u, 1e-9));
+        out.t[i + 1] = out.t[i] + dt;
+    }
+
+    out.u[n - 1] = n > 1 ? out.u[n - 2] : 0;
+}
+
+// appends b after a, both start and end at rest so the seam is a hold.
+// each was unwrapped from its own start, so b is moved by whole turns to
+// carry on from a rather than jump round at the seam
+static void Append(Trajectory& a, const Trajectory& b)
+{
+    float offset = a.setpoints.empty() ? 0.0f : (float)a.duration;
+    size_t first = a.setpoints.empty() ? 0 : 1;
+    float turn1 = 0, turn2 = 0;
+
+    if (!a.setpoints.empty() && !b.setpoints.empty())
+    {
+        const float TWO_PI = 6.28318530718f;
+        turn1 = TWO_PI * std::round((a.setpoints.back().theta1 - b.setpoints[0].theta1) / TWO_PI);
+        turn2 = TWO_PI * std::round((a.setpoints.back().theta2 - b.setpoints[0].theta2) / TWO_PI);
+    }
+
+    for (size_t i = first; i < b.setpoints.size(); i++)
+    {
+        JointSetpoint sp = b.setpoints[i];
+        sp.t += offset;
+        sp.theta1 += turn1;
+        sp.theta2 += turn2;
+        a.setpoints.push_back(sp);
+    }
+
+    a.duration += b.duration;
+    a.ikFailures += b.ikFailures;
+    a.peakVelocity = std::max(a.peakVelocity, b.peakVelocity);
+    a.peakAcceleration = std::max(a.peakAcceleration, b.peakAcceleration);
+    a.peakJerk = std::max(a.peakJerk, b.peakJerk);
+}
+
+// joint angle and its slope along the path from the spline
+static double Spline(const PathSamples& p, int j, double s, double& slope)
+{
+    int n = (int)p.x.size();
+    int i = std::clamp((int)(s / p.step), 0, n - 2);
+    double b = std::clamp(s / p.step - i, 0.0, 1.0);
+    double a = 1.0 - b;
+    double h = p.step;
+
+    double y0 = p.theta[j][i], y1 = p.theta[j][i + 1];
+    double m0 = p.d2[j][i], m1 = p.d2[j][i + 1];
+
+    slope = (y1 - y0) / h - (3 * a * a - 1) / 6 * h * m0 + (3 * b * b - 1) / 6 * h * m1;
+
+    return a * y0 + b * y1 + ((a * a * a - a) * m0 + (b * b * b - b) * m1) * h * h / 6;
+}
+
+// speed profile and setpoints for solved samples, rest to rest
+static Trajectory Retime(const PathSamples& p, const MotorLimits& limits, int window, double dt)
+{
+    Trajectory traj;
+    traj.dt = dt;
+
+    int n = (int)p.x.size();
+    Profile f;
+    SolveProfile(p, limits, f);
+
+    // path position on the control grid, constant path acceleration per segment
+    int steps = (int)std::ceil(f.t[n - 1] / dt - 1e-9);
+    std::vector<double> s(steps + 1);
+    int seg = 0;
+
+    for (int k = 0; k <= steps; k++)
+    {
+        double t = std::min(k * dt, f.t[n - 1]);
+        while (seg + 1 < n - 1 && f.t[seg + 1] <= t) seg++;
+
+        double tau = t - f.t[seg];
+        double ds = std::sqrt(f.x[seg]) * tau + 0.5 * f.u[seg] * tau * tau;
+
+        s[k] = std::clamp(seg * (double)p.step + ds, 0.0, (n - 1) * (double)p.step);
+    }
+
+    // a moving average turns the bang-bang acceleration into ramps. only
+    // the timing changes, the end effector stays on the path
+    int total = steps + window - 1;
+    double sum = 0;
+
+    traj.duration = total * dt;
+    traj.setpoints.reserve(total + 1);
+
+    for (int k = 0; k <= total; k++)
+    {
+        double in = s[std::min(k, steps)];
+        double out = k >= window ? s[std::min(k - window, steps)] : 0.0;
+
+        sum += in - out;
+
+        double sf = sum / window;
+        double sdot = (in - out) / (window * dt);
+
+        JointSetpoint sp;
+        double slope1, slope2;
+
+        sp.t = (float)(k * dt);
+        sp.theta1 = (float)Spline(p, 0, sf, slope1);
+        sp.theta2 = (float)Spline(p, 1, sf, slope2);
+        sp.omega1 = (float)(slope1 * sdot);
+        sp.omega2 = (float)(slope2 * sdot);
+
+        int i = std::clamp((int)(sf / p.step), 0, n - 2);
+        float w = (float)std::clamp(sf / p.step - i, 0.0, 1.0);
+        sp.x = p.x[i] + (p.x[i + 1] - p.x[i]) * w;
+        sp.y = p.y[i] + (p.y[i + 1] - p.y[i]) * w;
+
+        traj.setpoints.push_back(sp);
+    }
+
+    // measured off the setpoints the controller will actually get
+    const std::vector<JointSetpoint>& sp = traj.setpoints;
+    float previous[2] = {0, 0};
+
+    for (size_t k = 1; k < sp.size(); k++)
+    {
+        float v[2] = {sp[k].omega1, sp[k].omega2};
+        float last[2] = {sp[k - 1].omega1, sp[k - 1].omega2};
+
+        for (int j = 0; j < 2; j++)
+        {
+            float a = (v[j] - last[j]) / (float)dt;
+
+            traj.peakVelocity = std::max(traj.peakVelocity, std::fabs(v[j]));
+            traj.peakAcceleration = std::max(traj.peakAcceleration, std::fabs(a));
+            if (k > 1) traj.peakJerk = std::max(traj.peakJerk, std::fabs(a - previous[j]) / (float)dt);
+
+            previous[j] = a;
+        }
+    }
+
+    return traj;
+}
+
+// one smooth stretch of path, rest to rest
+static Trajectory SmoothPiece(const FiveBar& g, const std::vector<Vector2>& waypoints, const MotorLimits& limits, double dt)
+{
+    PathSamples p;
+    Resample(waypoints, p);
+    int failures = SolveSamples(g, p);
+
+    // a full swing of 2a over the averaging window is 2/3 of the jerk
+    // limit, the rest is left for the path curvature terms
+    int window = std::max(1, (int)std::lround(3.0 * limits.acceleration / limits.jerk / dt));
+
+    // the averaging can push the curvature terms past the limits near
+    // singular poses, so slow the whole piece down until the measured
+    // rates fit. a percent of slack keeps rounding from costing a round
+    MotorLimits local = limits;
+    Trajectory traj = Retime(p, local, window, dt);
+
+    auto Over = [&](const Trajectory& t)
+    {
+        return t.peakVelocity > limits.velocity * 1.01f || t.peakAcceleration > limits.acceleration * 1.01f ||
+               t.peakJerk > limits.jerk * 1.01f;
+    };
+
+    for (int round = 0; round < LIMIT_ROUNDS && Over(traj); round++)
+    {
+        local.velocity *= 0.8f;
+        local.acceleration *= 0.8f;
+        traj = Retime(p, local, window, dt);
+    }
+
+    traj.ikFailures = failures;
+
+    return traj;
+}
+
+Trajectory TimeOptimal(const FiveBar& g, const std::vector<Vector2>& waypoints, const MotorLimits& limits, double dt)
+{
+    Trajectory traj;
+    traj.dt = dt;
+
+    // nowhere to go, as when the arm already rests at the start of a leg
+    float length = 0;
+    for (size_t i = 1; i < waypoints.size(); i++)
+        length += std::hypot(waypoints[i].x - waypoints[i - 1].x, waypoints[i].y - waypoints[i - 1].y);
+
+    if (length < 1e-4f) return traj;
+
+    // the joint velocity cannot jump, so the arm has to stop at every
+    // sharp corner. split there and run each smooth stretch rest to rest
+    std::vector<Vector2> piece = {waypoints[0]};
+
+    for (size_t i = 1; i < waypoints.size(); i++)
+    {
+        piece.push_back(waypoints[i]);
+
+        if (i + 1 == waypoints.size()) break;
+
+        Vector2 a = waypoints[i - 1], b = waypoints[i], c = waypoints[i + 1];
+        float ux = b.x - a.x, uy = b.y - a.y, vx = c.x - b.x, vy = c.y - b.y;
+        float lu = std::hypot(ux, uy), lv = std::hypot(vx, vy);
+
+        if (lu > 1e-6f && lv > 1e-6f && (ux * vx + uy * vy) < CORNER_COS * lu * lv)
+        {
+            Append(traj, SmoothPiece(g, piece, limits, dt));
+            piece = {b};
+        }
+    }
+
+    Append(traj, SmoothPiece(g, piece, limits, dt));
+
+    return traj;
+}
+
+Trajectory LegTrajectory(const FiveBar& g, const std::vector<Vector2>& route, const MotorLimits& limits, double dt)
+{
+    // blends sampled well inside the spline spacing, so the resampled
+    // points sit on the curve and not on its chords
+    return TimeOptimal(g, SmoothPath(route, squareSize * CORNER_CUT, SAMPLE_SPACING / 8), limits, dt);
+}
+
+Trajectory PlanTrajectory(const FiveBar& g, const MovePlan& plan, const MotorLimits& limits, const MotorLimits& transit,
+                          double dt)
+{
+    Trajectory traj;
+    traj.dt = dt;
+
+    if (plan.hasStart && !plan.legs.empty()) traj = TimeOptimal(g, {plan.start, plan.legs[0].path.front()}, transit, dt);
+
+    trajectoryCache.calibrate(g);
+
+    for (const Leg& leg : plan.legs)
+    {
+        if (!traj.setpoints.empty())
+        {
+            const JointSetpoint& end = traj.setpoints.back();
+            Append(traj, TimeOptimal(g, {{end.x, end.y}, leg.path.front()}, transit, dt));
+        }
+
+        Trajectory tabled;
+        if (leg.table && trajectoryTable.trajectory(leg.from, leg.to, tabled))
+        {
+            Append(traj, tabled);
+            continue;
+        }
+
+        std::shared_ptr<const Trajectory> solved = leg.key ? trajectoryCache.findTrajectory(leg.key, limits, dt) : nullptr;
+
+        if (!solved)
+        {
+            solved = std::make_shared<const Trajectory>(LegTrajectory(g, leg.path, limits, dt));
+            if (leg.key) trajectoryCache.storeTrajectory(leg.key, limits, dt, solved);
+        }
+
+        Append(traj, *solved);
+    }
+
+    return traj;
+}
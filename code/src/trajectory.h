@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <raylib.h>
+#include "kinematics.h"
+#include "plan.h"
+
+// per motor bounds, rad/s, rad/s^2, rad/s^3
+struct MotorLimits
+{
+    float velocity;
+    float acceleration;
+    float jerk;
+};
+
+struct JointSetpoint
+{
+    float t;
+    float theta1, theta2;
+    float omega1, omega2;
+    float x, y;   // end effector on the path
+};
+
+struct Trajectory
+{
+    std::vector<JointSetpoint> setpoints;   // every dt, at rest at both ends
+    double dt = 0;
+    double duration = 0;
+    int ikFailures = 0;
+
+    // worst joint rates reached, for checking against the limits
+    float peakVelocity = 0;
+    float peakAcceleration = 0;
+    float peakJerk = 0;
+};
+
+// time optimal along the polyline from rest to rest. the path is resampled
+// by arc length and pushed through the batch ik, then the fastest speed
+// profile inside the joint velocity and acceleration limits is found with
+// a backward pass for the largest speed each sample can still stop from and
+// a forward pass that accelerates as hard as that allows (topp-ra on a
+// discrete path). jerk is bounded afterwards by a moving average over the
+// path position, which retimes without leaving the path, and a piece whose
+// measured rates still overshoot is replanned slower. the arm stops at
+// sharp corners, where the joint velocity would otherwise have to jump
+Trajectory TimeOptimal(const FiveBar& g, const std::vector<Vector2>& waypoints, const MotorLimits& limits, double dt);
+
+// a leg along its route, corners blended, from rest to rest
+Trajectory LegTrajectory(const FiveBar& g, const std::vector<Vector2>& route, const MotorLimits& limits, double dt);
+
+// every transit and leg of a move back to back, stopping between them
+// while the magnet switches. the empty arm runs to the transit limits,
+// from the plan's start when it has one
+Trajectory PlanTrajectory(const FiveBar& g, const MovePlan& plan, const MotorLimits& limits, const MotorLimits& transit,
+                          double dt);
@@ -0,0 +1,44 @@
+#include "uci.h"
+
+// past the fifty move rule the tail carries no extra information
+const int MAX_TAIL_PLIES = 100;
+
+void PositionCommand::reset()
+{
+    base = "startpos";
+    tail.clear();
+    plies = 0;
+}
+
+void PositionCommand::push(const Board& after, const std::string& uci, bool irreversible)
+{
+    if (irreversible || plies >= MAX_TAIL_PLIES)
+    {
+        after.fen(scratch);
+        base.assign("fen ");
+        base += scratch;
+
+        tail.clear();
+        plies = 0;
+        return;
+    }
+
+    tail += ' ';
+    tail += uci;
+    plies++;
+}
+
+const std::string& PositionCommand::build()
+{
+    cmd.clear();
+    cmd += "position ";
+    cmd += base;
+
+    if (plies)
+    {
+        cmd += " moves";
+        cmd += tail;
+    }
+
+    return cmd;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include "board.h"
+
+// builds "position ..." for the engine without replaying the whole game:
+// the base is re-anchored to a fen at every irreversible move, so only the
+// reversible tail (needed for repetition detection) is resent
+class PositionCommand
+{
+public:
+    PositionCommand() { reset(); }
+
+    void reset();
+    void push(const Board& after, const std::string& uci, bool irreversible);
+
+    const std::string& build();
+    int window() const { return plies; }
+
+private:
+    std::string base;
+    std::string tail;
+    std::string cmd;
+    std::string scratch;
+    int plies = 0;
+};
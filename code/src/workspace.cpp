@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "workspace.h"
+
+const char WORKSPACE_MAGIC[4] = {'5', 'B', 'W', 'S'};
+const uint32_t WORKSPACE_VERSION = 1;
+
+struct WorkspaceHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t cellBytes;
+    FiveBar geometry;
+    float x0, y0, cell;
+    int32_t nx, ny;
+};
+
+// true when the open segments p1-p2 and q1-q2 cross
+static bool SegmentsCross(float p1x, float p1y, float p2x, float p2y, float q1x, float q1y, float q2x, float q2y)
+{
+    auto Orient = [](float ax, float ay, float bx, float by, float cx, float cy)
+    {
+        return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    };
+
+    float a = Orient(p1x, p1y, p2x, p2y, q1x, q1y);
+    float b = Orient(p1x, p1y, p2x, p2y, q2x, q2y);
+    float c = Orient(q1x, q1y, q2x, q2y, p1x, p1y);
+    float d = Orient(q1x, q1y, q2x, q2y, p2x, p2y);
+
+    return ((a > 0 && b < 0) || (a < 0 && b > 0)) && ((c > 0 && d < 0) || (c < 0 && d > 0));
+}
+
+static void Measure(const FiveBar& g, float x, float y, WorkspaceCell& c)
+{
+    float bx = g.ax + g.l1 * std::cos(c.theta1), by = g.ay + g.l1 * std::sin(c.theta1);
+    float dx = g.ex + g.l4 * std::cos(c.theta2), dy = g.ey + g.l4 * std::sin(c.theta2);
+
+    // distal links, and the rates the motors push the elbows across them
+    float ux = x - bx, uy = y - by;
+    float vx = x - dx, vy = y - dy;
+    float w1 = ux * -std::sin(c.theta1) + uy * std::cos(c.theta1);
+    float w2 = vx * -std::sin(c.theta2) + vy * std::cos(c.theta2);
+
+    // the loop closure gives [u; v] dC = diag(L1 w1, L4 w2) dtheta, so
+    // det J = L1 L4 w1 w2 / (u x v). u x v = 0 is the distal links lining
+    // up, w = 0 a distal link folding onto its proximal one
+    float cross = ux * vy - uy * vx;
+
+    c.manipulability = std::fabs(g.l1 * g.l4 * w1 * w2) / std::max(std::fabs(cross), 1e-3f);
+    c.singularity = std::min({std::fabs(cross) / (g.l2 * g.l3), std::fabs(w1) / g.l2, std::fabs(w2) / g.l3});
+
+    if (SegmentsCross(g.ax, g.ay, bx, by, g.ex, g.ey, dx, dy) ||
+        SegmentsCross(g.ax, g.ay, bx, by, dx, dy, x, y) ||
+        SegmentsCross(g.ex, g.ey, dx, dy, bx, by, x, y)) c.flags |= WS_COLLISION;
+}
+
+void WorkspaceMap::build(const FiveBar& g, float x0, float y0, float width, float height, float cell)
+{
+    geometry = g;
+    this->x0 = x0;
+    this->y0 = y0;
+    this->cell = cell;
+
+    nx = std::max(1, (int)std::ceil(width / cell));
+    ny = std::max(1, (int)std::ceil(height / cell));
+
+    cells.assign((size_t)nx * ny, WorkspaceCell{});
+
+    std::vector<float> xs(nx), ys(nx), t1(nx), t2(nx);
+    std::vector<uint8_t> valid(nx);
+
+    for (int i = 0; i < nx; i++) xs[i] = x0 + (i + 0.5f) * cell;
+
+    // one batch ik call per row
+    for (int j = 0; j < ny; j++)
+    {
+        std::fill(ys.begin(), ys.end(), y0 + (j + 0.5f) * cell);
+        SolveIKBatch(g, xs.data(), ys.data(), nx, t1.data(), t2.data(), valid.data());
+
+        for (int i = 0; i < nx; i++)
+        {
+            WorkspaceCell& c = cells[j * nx + i];
+            if (!valid[i]) continue;
+
+            c.theta1 = t1[i];
+            c.theta2 = t2[i];
+            c.flags = WS_REACHABLE;
+
+            Measure(g, xs[i], ys[i], c);
+        }
+    }
+}
+
+bool WorkspaceMap::load(const std::string& path, const FiveBar& g, float x0, float y0, float width, float height, float cell)
+{
+    WorkspaceHeader h;
+    std::ifstream in(path, std::ios::binary);
+
+    int wantX = std::max(1, (int)std::ceil(width / cell));
+    int wantY = std::max(1, (int)std::ceil(height / cell));
+
+    bool match = in.read((char*)&h, sizeof(h)) &&
+                 !memcmp(h.magic, WORKSPACE_MAGIC, 4) && h.version == WORKSPACE_VERSION &&
+                 h.cellBytes == sizeof(WorkspaceCell) && !memcmp(&h.geometry, &g, sizeof(FiveBar)) &&
+                 h.x0 == x0 && h.y0 == y0 && h.cell == cell && h.nx == wantX && h.ny == wantY;
+
+    if (match)
+    {
+        cells.resize((size_t)h.nx * h.ny);
+
+        if (in.read((char*)cells.data(), cells.size() * sizeof(WorkspaceCell)))
+        {
+            geometry = g;
+            this->x0 = x0;
+            this->y0 = y0;
+            this->cell = cell;
+            nx = h.nx;
+            ny = h.ny;
+
+            return true;
+        }
+    }
+
+    build(g, x0, y0, width, height, cell);
+    save(path);
+
+    return false;
+}
+
+bool WorkspaceMap::save(const std::string& path) const
+{
+    WorkspaceHeader h = {};
+
+    memcpy(h.magic, WORKSPACE_MAGIC, 4);
+    h.version = WORKSPACE_VERSION;
+    h.cellBytes = sizeof(WorkspaceCell);
+    h.geometry = geometry;
+    h.x0 = x0;
+    h.y0 = y0;
+    h.cell = cell;
+    h.nx = nx;
+    h.ny = ny;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)cells.data(), cells.size() * sizeof(WorkspaceCell));
+
+    return (bool)out;
+}
+
+const WorkspaceCell* WorkspaceMap::at(float x, float y) const
+{
+    int i = (int)std::floor((x - x0) / cell);
+    int j = (int)std::floor((y - y0) / cell);
+
+    if (i < 0 || j < 0 || i >= nx || j >= ny) return nullptr;
+
+    return &cells[j * nx + i];
+}
+
+bool WorkspaceMap::feasible(float x, float y, float minSingularity) const
+{
+    const WorkspaceCell* c = at(x, y);
+
+    return c && (c->flags & (WS_REACHABLE | WS_COLLISION)) == WS_REACHABLE && c->singularity >= minSingularity;
+}
+
+bool WorkspaceMap::warmStart(float x, float y, float& theta1, float& theta2) const
+{
+    const WorkspaceCell* c = at(x, y);
+    if (!c || !(c->flags & WS_REACHABLE)) return false;
+
+    theta1 = c->theta1;
+    theta2 = c->theta2;
+
+    return true;
+}
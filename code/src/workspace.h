@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "kinematics.h"
+
+enum WorkspaceFlags
+{
+    WS_REACHABLE = 1,   // inside both annuli, so the ik has a solution
+    WS_COLLISION = 2    // the elbows-out pose crosses its own links
+};
+
+struct WorkspaceCell
+{
+    float theta1;
+    float theta2;
+    float manipulability;   // |det J|, mm of end effector per rad of motor squared
+    float singularity;      // sine of the worst joint angle, 0 at a singular pose, 1 at best
+    uint8_t flags;
+};
+
+// dense grid over a rectangle of the plane, cell centres at
+// (x0 + (i + 0.5) * cell, y0 + (j + 0.5) * cell)
+class WorkspaceMap
+{
+public:
+    void build(const FiveBar& g, float x0, float y0, float width, float height, float cell);
+
+    // reuses the cache at path when it was built for the same geometry and
+    // grid, otherwise builds and writes it
+    bool load(const std::string& path, const FiveBar& g, float x0, float y0, float width, float height, float cell);
+    bool save(const std::string& path) const;
+
+    // nullptr outside the grid
+    const WorkspaceCell* at(float x, float y) const;
+
+    // reachable, collision free and at least minSingularity away from a singular pose
+    bool feasible(float x, float y, float minSingularity = 0.1f) const;
+
+    // nearest cell's angles, a starting guess for iterative solvers
+    bool warmStart(float x, float y, float& theta1, float& theta2) const;
+
+    int columns() const { return nx; }
+    int rows() const { return ny; }
+    float cellSize() const { return cell; }
+    float originX() const { return x0; }
+    float originY() const { return y0; }
+    const WorkspaceCell& cellAt(int col, int row) const { return cells[row * nx + col]; }
+
+    bool empty() const { return cells.empty(); }
+
+private:
+    FiveBar geometry = {};
+    float x0 = 0, y0 = 0, cell = 1;
+    int nx = 0, ny = 0;
+    std::vector<WorkspaceCell> cells;
+};
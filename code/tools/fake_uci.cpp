@@ -0,0 +1,174 @@
+// minimal UCI stand-in for exercising the engine client without stockfish
+//
+//   fake_uci [--delay ms] [--moves e2e4,e7e5,...] [--hang] [--exit-after n]
+//
+// replies to go with the scripted move for the current ply, after the delay
+// or as soon as stop arrives, naming the next scripted move as the one to
+// ponder. go ponder waits for ponderhit before the delay starts. --hang
+// never answers go, --exit-after dies after n searches.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> script =
+{
+    "e2e4", "e7e5", "g1f3", "b8c6", "f1c4", "g8f6", "d2d3", "f8c5",
+    "c2c3", "d7d6", "e1g1", "e8g8", "b1d2", "a7a6", "c4b3", "c5a7"
+};
+
+int delayMs = 100;
+bool hang = false;
+int exitAfter = -1;
+
+int ply = 0;
+int searches = 0;
+
+bool thinking = false;
+bool pondering = false;
+int searchMs = 0;
+Clock::time_point deadline;
+
+void Reply(const std::string& line)
+{
+    fprintf(stdout, "%s\n", line.c_str());
+    fflush(stdout);
+}
+
+void BestMove()
+{
+    thinking = false;
+    pondering = false;
+    searches++;
+
+    if (ply + 1 < (int)script.size())
+    {
+        Reply("info depth 1 score cp 0 pv " + script[ply] + " " + script[ply + 1]);
+        Reply("bestmove " + script[ply] + " ponder " + script[ply + 1]);
+    }
+    else if (ply < (int)script.size())
+    {
+        Reply("info depth 1 score cp 0 pv " + script[ply]);
+        Reply("bestmove " + script[ply]);
+    }
+    else Reply("bestmove (none)");
+
+    if (exitAfter >= 0 && searches >= exitAfter) exit(0);
+}
+
+void Position(std::istringstream& in)
+{
+    std::string token;
+    ply = 0;
+
+    while (in >> token && token != "moves") {}
+    while (in >> token) ply++;
+}
+
+void Go(std::istringstream& in)
+{
+    std::string token;
+    int movetime = delayMs;
+
+    pondering = false;
+
+    while (in >> token)
+    {
+        if (token == "movetime") in >> movetime;
+        else if (token == "ponder") pondering = true;
+    }
+
+    thinking = true;
+    searchMs = std::min(movetime, delayMs);
+    deadline = Clock::now() + std::chrono::milliseconds(searchMs);
+}
+
+void PonderHit()
+{
+    pondering = false;
+    deadline = Clock::now() + std::chrono::milliseconds(searchMs);
+}
+
+bool Command(const std::string& line)
+{
+    std::istringstream in(line);
+    std::string cmd;
+    in >> cmd;
+
+    if (cmd == "uci")
+    {
+        Reply("id name FakeUCI");
+        Reply("uciok");
+    }
+    else if (cmd == "isready") Reply("readyok");
+    else if (cmd == "position") Position(in);
+    else if (cmd == "go") Go(in);
+    else if (cmd == "ponderhit" && pondering) PonderHit();
+    else if (cmd == "stop" && thinking) BestMove();
+    else if (cmd == "quit") return false;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--delay") && i + 1 < argc) delayMs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hang")) hang = true;
+        else if (!strcmp(argv[i], "--exit-after") && i + 1 < argc) exitAfter = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--moves") && i + 1 < argc)
+        {
+            script.clear();
+
+            std::istringstream in(argv[++i]);
+            std::string m;
+            while (std::getline(in, m, ',')) if (!m.empty()) script.push_back(m);
+        }
+    }
+
+    std::string pending;
+    char buffer[512];
+
+    while (true)
+    {
+        int timeout = -1;
+
+        if (thinking && !pondering && !hang)
+        {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            timeout = left > 0 ? (int)left : 0;
+        }
+
+        pollfd p = {STDIN_FILENO, POLLIN, 0};
+        int r = poll(&p, 1, timeout);
+
+        if (r == 0)
+        {
+            BestMove();
+            continue;
+        }
+
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n <= 0) return 0;
+
+        pending.append(buffer, n);
+
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+
+            if (!Command(line)) return 0;
+        }
+    }
+}
@@ -0,0 +1,435 @@
+// 5bar_headless [--out file] [--json] [--repeat n] [--table file] [--device path] [--baud n]
+//               [--steps file] [--moves e2e4,e7e5,...] [games.pgn | games.txt ...]
+//
+// runs the move pipeline without a window: every move is validated,
+// planned into arm legs, solved and played through the fixed timestep
+// simulation as fast as the cpu allows. per move metrics go to --out as
+// csv, or json with --json. .pgn files are read as pgn, anything else as
+// one game of whitespace separated uci moves per line. --table takes legs
+// the pieces leave clear from a 5bar_table file instead of planning them.
+// --device streams every move's setpoints to a controller on a serial
+// device, such as the one 5bar_vcontroller opens, and waits for it to
+// play them all. --steps writes the step and direction events of the whole
+// run, with the arm brought home between games
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "cache.h"
+#include "config.h"
+#include "link.h"
+#include "lookahead.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "plan.h"
+#include "sim.h"
+#include "steps.h"
+#include "table.h"
+#include "trajectory.h"
+#include "workspace.h"
+
+struct ScriptedGame
+{
+    std::string name;
+    std::string fen;
+    std::vector<std::string> moves;   // san when pgn, uci otherwise
+    bool san = false;
+};
+
+struct MoveMetrics
+{
+    int game;
+    int ply;
+    std::string move;
+    int legs;
+    int points;
+    double pathLength;    // end effector travel, board units
+    int ikFailures;
+    int outside;          // samples the workspace map rejects
+    double execSeconds;   // simulated time to play the path at the fixed sample rate
+    double toppSeconds;   // the same move on the time optimal trajectory
+    double lookaheadSeconds;   // its path streamed through the lookahead planner
+    float peakVelocity;
+    float peakAcceleration;
+    float peakJerk;
+    float peakCondition;  // worst jacobian condition the simulated arm passed through
+    double planMicros;    // wall time to plan and solve
+};
+
+static bool LoadGames(const std::string& path, std::vector<ScriptedGame>& games)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+
+    bool pgn = path.size() >= 4 && path.compare(path.size() - 4, 4, ".pgn") == 0;
+
+    if (pgn)
+    {
+        PgnGame game;
+        while (ReadPgnGame(in, game))
+        {
+            ScriptedGame g;
+            g.name = game.tags.count("Event") ? game.tags["Event"] : path;
+            g.fen = game.tags.count("FEN") ? game.tags["FEN"] : START_FEN;
+            g.moves = game.san;
+            g.san = true;
+            games.push_back(g);
+        }
+
+        return true;
+    }
+
+    std::string line;
+    int n = 0;
+
+    while (std::getline(in, line))
+    {
+        std::istringstream words(line);
+        ScriptedGame g;
+        std::string m;
+
+        g.name = path + ":" + std::to_string(++n);
+        g.fen = START_FEN;
+
+        while (words >> m) g.moves.push_back(m);
+        if (!g.moves.empty()) games.push_back(g);
+    }
+
+    return true;
+}
+
+static double PathLength(const std::vector<Vector2>& path)
+{
+    double length = 0;
+
+    for (size_t i = 1; i < path.size(); i++)
+        length += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+
+    return length;
+}
+
+int tableLegs = 0;
+int totalLegs = 0;
+
+// step events of every move, when --steps asks for them
+StepTimeline timeline(STEPPERS);
+std::vector<StepEvent> stepEvents;
+bool recordSteps = false;
+Vector2 stepArm = ARM_HOME;
+
+// plays the plan's paths through the lookahead planner as they would be
+// streamed, stopping for the magnet at both ends of every leg. points out
+// of the arm's reach are skipped, the simulation counts them as ik
+// failures. a move that would take longer than LOOKAHEAD_LIMIT is cut off
+// there rather than left to spin
+const double LOOKAHEAD_LIMIT = 600;
+
+static double LookaheadSeconds(const MovePlan& plan, Vector2 start, double dt)
+{
+    LookaheadPlanner planner(ARM_GEOMETRY, MOTOR_LIMITS, start);
+    JointSetpoint sp;
+    uint64_t ticks = 0, limit = (uint64_t)(LOOKAHEAD_LIMIT / dt);
+
+    auto Queue = [&](Vector2 p, bool stop)
+    {
+        while (ticks < limit && !planner.append(p, stop) && planner.full())
+        {
+            planner.next(dt, sp);
+            ticks++;
+        }
+    };
+
+    for (const Leg& leg : plan.legs)
+    {
+        Queue(leg.path.front(), true);
+        for (size_t k = 1; k < leg.path.size(); k++) Queue(leg.path[k], k + 1 == leg.path.size());
+    }
+
+    while (ticks < limit && planner.next(dt, sp)) ticks++;
+
+    if (ticks >= limit) fprintf(stderr, "lookahead planner still moving after %.0f s, cut off\n", LOOKAHEAD_LIMIT);
+
+    return ticks * dt;
+}
+
+// false when a move does not resolve, the rest of the game is skipped
+static bool RunGame(const ScriptedGame& game, int index, const WorkspaceMap& workspace, std::vector<MoveMetrics>& out)
+{
+    Board board;
+    Graveyard graveyard;
+    Simulation sim(ARM_GEOMETRY, CONTROL_HZ, PATH_POINT_RATE);
+    Vector2 arm = ARM_HOME;
+
+    if (!board.setFen(game.fen)) return false;
+
+    if (recordSteps) timeline.append(TimeOptimal(ARM_GEOMETRY, {stepArm, ARM_HOME}, TRANSIT_LIMITS, sim.timestep()), stepEvents);
+
+    for (size_t i = 0; i < game.moves.size(); i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        Move m;
+        bool ok = game.san ? SanToMove(board, game.moves[i], m) : ValidateUci(board, game.moves[i], m);
+
+        if (!ok)
+        {
+            fprintf(stderr, "%s: ply %zu %s is not legal\n", game.name.c_str(), i + 1, game.moves[i].c_str());
+            return false;
+        }
+
+        // each move starts where the last one left the arm
+        Vector2 from = arm;
+        MovePlan plan = PlanMove(board, m, graveyard, &arm);
+
+        if (plan.legs.empty())
+        {
+            fprintf(stderr, "%s: ply %zu %s has no reachable graveyard slot\n", game.name.c_str(), i + 1, game.moves[i].c_str());
+            return false;
+        }
+
+        arm = PlanEnd(plan);
+        std::vector<Vector2> path = BuildPlanPath(plan);
+        sim.setPath(path, false);
+
+        double planMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        int outside = 0;
+        for (const Vector2& p : path) if (!workspace.feasible(p.x, p.y)) outside++;
+
+        uint64_t before = sim.ticks();
+        float peakCondition = sim.state().condition;
+
+        while (!sim.finished())
+        {
+            sim.step();
+            peakCondition = std::max(peakCondition, sim.state().condition);
+        }
+
+        MoveMetrics r;
+        r.game = index;
+        r.ply = (int)i + 1;
+        r.move = MoveToUci(m);
+        r.legs = (int)plan.legs.size();
+        totalLegs += r.legs;
+        for (const Leg& leg : plan.legs) tableLegs += leg.table;
+        r.points = (int)path.size();
+        r.pathLength = PathLength(path);
+        r.ikFailures = sim.ikFailures();
+        r.outside = outside;
+        r.execSeconds = (sim.ticks() - before) * sim.timestep();
+        r.planMicros = planMicros;
+        r.peakCondition = peakCondition;
+
+        Trajectory traj = PlanTrajectory(ARM_GEOMETRY, plan, MOTOR_LIMITS, TRANSIT_LIMITS, sim.timestep());
+        r.toppSeconds = traj.duration;
+        r.lookaheadSeconds = LookaheadSeconds(plan, from, sim.timestep());
+        r.peakVelocity = traj.peakVelocity;
+        r.peakAcceleration = traj.peakAcceleration;
+        r.peakJerk = traj.peakJerk;
+        out.push_back(r);
+
+        if (controller.connected()) controller.send(traj);
+
+        if (recordSteps)
+        {
+            timeline.append(traj, stepEvents);
+            stepArm = arm;
+        }
+
+        Undo u;
+        board.make(m, u);
+    }
+
+    return true;
+}
+
+static void WriteCsv(FILE* f, const std::vector<MoveMetrics>& rows)
+{
+    fprintf(f, "game,ply,move,legs,points,path_length,ik_failures,outside_workspace,exec_s,plan_us,"
+               "topp_s,lookahead_s,peak_velocity,peak_acceleration,peak_jerk,peak_condition\n");
+
+    for (const MoveMetrics& r : rows)
+        fprintf(f, "%d,%d,%s,%d,%d,%.2f,%d,%d,%.3f,%.1f,%.3f,%.3f,%.2f,%.1f,%.0f,%.1f\n", r.game, r.ply, r.move.c_str(),
+                r.legs, r.points, r.pathLength, r.ikFailures, r.outside, r.execSeconds, r.planMicros, r.toppSeconds,
+                r.lookaheadSeconds, r.peakVelocity, r.peakAcceleration, r.peakJerk, r.peakCondition);
+}
+
+static void WriteJson(FILE* f, const std::vector<MoveMetrics>& rows)
+{
+    fprintf(f, "[\n");
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const MoveMetrics& r = rows[i];
+        fprintf(f, "  {\"game\": %d, \"ply\": %d, \"move\": \"%s\", \"legs\": %d, \"points\": %d, \"path_length\": %.2f, "
+                   "\"ik_failures\": %d, \"outside_workspace\": %d, \"exec_s\": %.3f, \"plan_us\": %.1f, "
+                   "\"topp_s\": %.3f, \"lookahead_s\": %.3f, \"peak_velocity\": %.2f, \"peak_acceleration\": %.1f, \"peak_jerk\": %.0f, "
+                   "\"peak_condition\": %.1f}%s\n",
+                r.game, r.ply, r.move.c_str(), r.legs, r.points, r.pathLength, r.ikFailures, r.outside,
+                r.execSeconds, r.planMicros, r.toppSeconds, r.lookaheadSeconds, r.peakVelocity, r.peakAcceleration, r.peakJerk,
+                r.peakCondition, i + 1 < rows.size() ? "," : "");
+    }
+
+    fprintf(f, "]\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<ScriptedGame> games;
+    std::string outPath;
+    bool json = false;
+    int repeat = 1;
+    std::string device;
+    int baud = CONTROLLER_BAUD;
+    std::string stepsPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else if (!strcmp(argv[i], "--json")) json = true;
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--table") && i + 1 < argc)
+        {
+            if (!trajectoryTable.open(argv[++i], ARM_GEOMETRY, MOTOR_LIMITS, 1.0 / CONTROL_HZ))
+            {
+                fprintf(stderr, "%s is missing, damaged or was built for another arm\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (!strcmp(argv[i], "--device") && i + 1 < argc) device = argv[++i];
+        else if (!strcmp(argv[i], "--baud") && i + 1 < argc) baud = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc) stepsPath = argv[++i];
+        else if (!strcmp(argv[i], "--moves") && i + 1 < argc)
+        {
+            ScriptedGame g;
+            std::istringstream in(argv[++i]);
+            std::string m;
+
+            g.name = "--moves";
+            g.fen = START_FEN;
+            while (std::getline(in, m, ',')) g.moves.push_back(m);
+            games.push_back(g);
+        }
+        else if (!LoadGames(argv[i], games))
+        {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (games.empty())
+    {
+        fprintf(stderr, "usage: %s [--out file] [--json] [--repeat n] [--table file] [--device path] [--baud n] "
+                        "[--steps file] [--moves m1,m2,...] [games.pgn | games.txt ...]\n", argv[0]);
+        return 2;
+    }
+
+    if (!device.empty() && !controller.open(device, baud))
+    {
+        fprintf(stderr, "cannot open %s at %d baud\n", device.c_str(), baud);
+        return 2;
+    }
+
+    if (!stepsPath.empty())
+    {
+        IKSolution home = SolveIK(ARM_GEOMETRY, ARM_HOME.x, ARM_HOME.y);
+        timeline.reset(home.theta1, home.theta2);
+        recordSteps = true;
+    }
+
+    WorkspaceMap workspace;
+    workspace.load(WORKSPACE_CACHE, ARM_GEOMETRY, 0, 0, WIDTH, HEIGHT, 2.0f);
+
+    std::vector<MoveMetrics> rows;
+    int played = 0, failed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int r = 0; r < repeat; r++)
+    {
+        for (size_t i = 0; i < games.size(); i++)
+        {
+            // rows are keyed by attempt, so a failed game's partial
+            // rows stay apart from the next one's
+            if (RunGame(games[i], (int)(r * games.size() + i), workspace, rows)) played++;
+            else failed++;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double planned = 0;
+    for (const MoveMetrics& m : rows) planned += m.toppSeconds;
+
+    // the controller plays in real time, give it all of that and some
+    bool drained = !controller.connected() || controller.flush((int)(planned * 1000) + 5000);
+
+    FILE* f = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+    if (!f)
+    {
+        fprintf(stderr, "cannot write %s\n", outPath.c_str());
+        return 2;
+    }
+
+    if (json) WriteJson(f, rows);
+    else WriteCsv(f, rows);
+
+    if (f != stdout) fclose(f);
+
+    int ikFailures = 0;
+    double simSeconds = 0, toppSeconds = 0, lookaheadSeconds = 0;
+
+    for (const MoveMetrics& m : rows)
+    {
+        ikFailures += m.ikFailures;
+        simSeconds += m.execSeconds;
+        toppSeconds += m.toppSeconds;
+        lookaheadSeconds += m.lookaheadSeconds;
+    }
+
+    fprintf(stderr, "%d games, %zu moves, %d failed, %d ik failures, %.0f s simulated in %.2f s (%.0f games/hour)\n",
+            played, rows.size(), failed, ikFailures, simSeconds, seconds, played / seconds * 3600);
+    fprintf(stderr, "time optimal trajectories take %.0f s against %.0f s at the fixed sample rate\n", toppSeconds, simSeconds);
+    fprintf(stderr, "the lookahead planner takes %.0f s on the same paths\n", lookaheadSeconds);
+
+    uint64_t lookups = trajectoryCache.hits() + trajectoryCache.misses();
+    fprintf(stderr, "trajectory cache: %llu hits, %llu misses (%.0f%%), %zu legs held\n", (unsigned long long)trajectoryCache.hits(),
+            (unsigned long long)trajectoryCache.misses(), lookups ? 100.0 * trajectoryCache.hits() / lookups : 0.0,
+            trajectoryCache.size());
+    if (trajectoryTable.loaded()) fprintf(stderr, "trajectory table: %d of %d legs\n", tableLegs, totalLegs);
+
+    if (recordSteps)
+    {
+        const StepStats& s = timeline.stats();
+
+        if (!WriteStepStream(stepsPath, STEPPERS, stepEvents))
+        {
+            fprintf(stderr, "cannot write %s\n", stepsPath.c_str());
+            return 2;
+        }
+
+        fprintf(stderr, "steps: %llu + %llu over %.1f s, peak %.0f / %.0f a second, %llu events in %.1f kB to %s\n",
+                (unsigned long long)s.steps[0], (unsigned long long)s.steps[1], timeline.ticks() / (double)STEPPERS.clockHz,
+                s.peakRate[0], s.peakRate[1], (unsigned long long)(s.events + s.waits),
+                stepEvents.size() * sizeof(StepEvent) / 1e3, stepsPath.c_str());
+    }
+
+    if (controller.connected())
+    {
+        LinkStats l = controller.stats();
+        fprintf(stderr, "controller: %llu setpoints acknowledged%s, %llu frames, %llu resent, %u crc errors, "
+                        "min depth %d, %u underruns\n",
+                (unsigned long long)l.setpoints, drained ? "" : " before the timeout", (unsigned long long)l.frames,
+                (unsigned long long)l.resent, l.crcErrors, l.minDepth, l.underruns);
+        controller.close();
+    }
+
+    return failed || !drained ? 1 : 0;
+}
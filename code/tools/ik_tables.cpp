@@ -0,0 +1,57 @@
+// 5bar_ik_tables > ../arduino/controller/ik_tables.h
+//
+// writes the constants the controller's fixed point inverse kinematics
+// runs on: the arm in config.h in 1/16 board units, its reach limits, and
+// the cordic arctangent table as fractions of a turn. fixed_ik_bench
+// fails while the header in the sketch is not what this writes
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "config.h"
+
+// the sketch's copy of these, see fixed_ik.h
+const int POSITION_SCALE_FIXED = 16;
+const int CORDIC_ITERATIONS = 24;
+
+static long Fixed(float v)
+{
+    return std::lround(v * POSITION_SCALE_FIXED);
+}
+
+int main()
+{
+    const FiveBar& g = ARM_GEOMETRY;
+
+    long l1 = Fixed(g.l1), l2 = Fixed(g.l2), l3 = Fixed(g.l3), l4 = Fixed(g.l4);
+
+    printf("#pragma once\n");
+    printf("#include <stdint.h>\n\n");
+    printf("// written by 5bar_ik_tables from ARM_GEOMETRY in code/src/config.h, do not edit\n\n");
+    printf("namespace firmware\n{\n\n");
+
+    printf("// motors and links in 1/16 board units\n");
+    printf("const int32_t IK_AX = %ld;\nconst int32_t IK_AY = %ld;\n", Fixed(g.ax), Fixed(g.ay));
+    printf("const int32_t IK_EX = %ld;\nconst int32_t IK_EY = %ld;\n", Fixed(g.ex), Fixed(g.ey));
+    printf("const int32_t IK_L1 = %ld;\nconst int32_t IK_L4 = %ld;\n\n", l1, l4);
+
+    printf("// proximal squared less distal squared, and the reach of each arm\n");
+    printf("// squared, 1/256 units\n");
+    printf("const int32_t IK_K1 = %ld;\nconst int32_t IK_K2 = %ld;\n", l1 * l1 - l2 * l2, l4 * l4 - l3 * l3);
+    printf("const uint32_t IK_NEAR1 = %ld;\nconst uint32_t IK_FAR1 = %ld;\n", (l1 - l2) * (l1 - l2), (l1 + l2) * (l1 + l2));
+    printf("const uint32_t IK_NEAR2 = %ld;\nconst uint32_t IK_FAR2 = %ld;\n\n", (l4 - l3) * (l4 - l3), (l4 + l3) * (l4 + l3));
+
+    printf("// atan(2^-i), 2^32 a turn\n");
+    printf("const uint8_t IK_ITERATIONS = %d;\n", CORDIC_ITERATIONS);
+    printf("const uint32_t IK_ATAN[IK_ITERATIONS] = {\n");
+
+    for (int i = 0; i < CORDIC_ITERATIONS; i++)
+    {
+        double turns = std::atan(std::ldexp(1.0, -i)) / 6.283185307179586;
+        printf("%s%luu,%s", i % 4 == 0 ? "    " : "", (unsigned long)std::llround(std::ldexp(turns, 32)), i % 4 == 3 ? "\n" : " ");
+    }
+
+    printf("};\n\n} // namespace firmware\n");
+
+    return 0;
+}
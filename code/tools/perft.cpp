@@ -0,0 +1,90 @@
+// perft [--fen "<fen>"] [--moves e2e4,e7e5,...] [--divide] depth
+//
+// counts leaf nodes of the legal move tree, --divide splits the count per
+// root move for comparison against a reference engine
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "board.h"
+#include "movegen.h"
+
+int main(int argc, char** argv)
+{
+    std::string fen = START_FEN;
+    std::string moves;
+    bool divide = false;
+    int depth = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--fen") && i + 1 < argc) fen = argv[++i];
+        else if (!strcmp(argv[i], "--moves") && i + 1 < argc) moves = argv[++i];
+        else if (!strcmp(argv[i], "--divide")) divide = true;
+        else depth = atoi(argv[i]);
+    }
+
+    if (depth < 0)
+    {
+        fprintf(stderr, "usage: %s [--fen \"<fen>\"] [--moves m1,m2,...] [--divide] depth\n", argv[0]);
+        return 2;
+    }
+
+    Board board;
+    if (!board.setFen(fen))
+    {
+        fprintf(stderr, "bad fen: %s\n", fen.c_str());
+        return 2;
+    }
+
+    std::istringstream in(moves);
+    std::string uci;
+
+    while (std::getline(in, uci, ','))
+    {
+        Move m;
+        Undo u;
+
+        if (!ValidateUci(board, uci, m))
+        {
+            fprintf(stderr, "illegal move: %s\n", uci.c_str());
+            return 2;
+        }
+
+        board.make(m, u);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+
+    if (divide && depth > 0)
+    {
+        MoveList list;
+        GenerateLegal(board, list);
+
+        for (Move m : list)
+        {
+            Undo u;
+            board.make(m, u);
+            uint64_t n = Perft(board, depth - 1);
+            board.unmake(u);
+
+            printf("%s: %llu\n", MoveToUci(m).c_str(), (unsigned long long)n);
+            nodes += n;
+        }
+
+        printf("\n");
+    }
+    else nodes = Perft(board, depth);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("nodes %llu\n", (unsigned long long)nodes);
+    printf("time %.3f s\n", seconds);
+    printf("nps %.0f\n", seconds > 0 ? nodes / seconds : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+// replay [file.pgn ...]
+//
+// replays every game through the same decode/apply/plan path the robot
+// uses and checks board parity after each ply: make/unmake round trip,
+// incremental zobrist key, the engine position command, the physical leg
+// plan for castling and en passant, and the FinalFEN tag at the end
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "board.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "plan.h"
+#include "uci.h"
+
+// rebuilds a board the way the engine would read the position command
+static bool BoardFromCommand(const std::string& cmd, Board& board)
+{
+    std::istringstream in(cmd);
+    std::string token, fen;
+
+    in >> token >> token;
+
+    if (token == "startpos") board.reset();
+    else
+    {
+        while (in >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+        if (!board.setFen(fen)) return false;
+    }
+
+    if (token != "moves") in >> token;
+
+    while (in >> token) if (!board.applyUci(token)) return false;
+
+    return true;
+}
+
+static bool ReplayGame(const PgnGame& game, std::string& error)
+{
+    Board board, check;
+    Graveyard graveyard;
+    PositionCommand position;
+    std::string before, after, fen;
+
+    if (!PgnStartBoard(game, board))
+    {
+        error = "bad FEN tag";
+        return false;
+    }
+
+    bool fromFen = game.tags.count("FEN") > 0;
+    if (fromFen)
+    {
+        board.fen(fen);
+        position.push(board, "", true);
+    }
+
+    for (size_t i = 0; i < game.san.size(); i++)
+    {
+        const std::string& san = game.san[i];
+        char ply[32];
+        snprintf(ply, sizeof(ply), "ply %zu (%s): ", i + 1, san.c_str());
+
+        Move m;
+        Undo u;
+
+        if (!SanToMove(board, san, m))
+        {
+            error = std::string(ply) + "not a legal move";
+            return false;
+        }
+
+        MovePlan plan = PlanMove(board, m, graveyard);
+        size_t legs = 1 + ((m.flags & (MOVE_CASTLE | MOVE_CAPTURE)) ? 1 : 0);
+
+        if (plan.legs.empty())
+        {
+            error = std::string(ply) + "no reachable graveyard slot";
+            return false;
+        }
+
+        if (plan.legs.size() != legs)
+        {
+            error = std::string(ply) + "wrong number of physical legs";
+            return false;
+        }
+
+        // the piece taken leaves for a graveyard slot, before the mover
+        // lands on it unless it was taken en passant
+        if (m.flags & MOVE_CAPTURE)
+        {
+            int victim = (m.flags & MOVE_EP) ? m.to ^ 8 : m.to;
+            size_t leg = 0;
+
+            auto OffBoard = [](Cell c) { return c.file < 0 || c.file > 7; };
+
+            while (leg < legs && !(plan.legs[leg].piece == board.pieceOn(victim) && OffBoard(plan.legs[leg].to))) leg++;
+
+            if (leg == legs)
+            {
+                error = std::string(ply) + "captured piece not taken to the graveyard";
+                return false;
+            }
+
+            if (!(m.flags & MOVE_EP) && leg != 0)
+            {
+                error = std::string(ply) + "captured piece cleared after the move";
+                return false;
+            }
+        }
+
+        if ((m.flags & MOVE_CASTLE) && PieceKind(plan.legs[0].piece) != ROOK && PieceKind(plan.legs[1].piece) != ROOK)
+        {
+            error = std::string(ply) + "castling leg does not move a rook";
+            return false;
+        }
+
+        board.fen(before);
+        uint64_t key = board.key();
+
+        board.make(m, u);
+        board.unmake(u);
+        board.fen(after);
+
+        if (before != after || key != board.key())
+        {
+            error = std::string(ply) + "unmake does not restore " + before;
+            return false;
+        }
+
+        bool irreversible = board.isIrreversible(m);
+        board.make(m, u);
+        position.push(board, MoveToUci(m), irreversible);
+
+        board.fen(fen);
+        check.setFen(fen);
+
+        if (check.key() != board.key())
+        {
+            error = std::string(ply) + "incremental key drifted at " + fen;
+            return false;
+        }
+
+        if (!BoardFromCommand(position.build(), check) || (check.fen(after), after != fen))
+        {
+            error = std::string(ply) + "position command gives " + after + " instead of " + fen;
+            return false;
+        }
+    }
+
+    auto it = game.tags.find("FinalFEN");
+    board.fen(fen);
+
+    if (it != game.tags.end() && it->second != fen)
+    {
+        error = "final position " + fen + " expected " + it->second;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int games = 0, failures = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream in(argv[i]);
+        if (!in)
+        {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 2;
+        }
+
+        PgnGame game;
+        while (ReadPgnGame(in, game))
+        {
+            std::string error;
+            bool ok = ReplayGame(game, error);
+
+            games++;
+            if (!ok) failures++;
+
+            printf("%-4s %s (%zu plies)%s%s\n", ok ? "ok" : "FAIL", game.tags["Event"].c_str(), game.san.size(),
+                   ok ? "" : ": ", error.c_str());
+        }
+    }
+
+    printf("%d games, %d failed\n", games, failures);
+
+    return failures ? 1 : 0;
+}
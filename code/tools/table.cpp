@@ -0,0 +1,53 @@
+// 5bar_table [--out file] [--threads n]
+//
+// solves the free board route and time optimal trajectory between every
+// pair of squares and graveyard slots for the arm and board in config.h,
+// and writes them for the runtime to map. the file is only picked up
+// while the geometry, board placement, limits and control rate match
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "config.h"
+#include "table.h"
+
+int main(int argc, char** argv)
+{
+    std::string outPath = TRAJECTORY_TABLE;
+    int threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) outPath = argv[++i];
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--out file] [--threads n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (!TrajectoryTable::build(outPath, ARM_GEOMETRY, MOTOR_LIMITS, 1.0 / CONTROL_HZ, threads))
+    {
+        fprintf(stderr, "cannot write %s\n", outPath.c_str());
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TrajectoryTable table;
+    if (!table.open(outPath, ARM_GEOMETRY, MOTOR_LIMITS, 1.0 / CONTROL_HZ))
+    {
+        fprintf(stderr, "%s does not read back\n", outPath.c_str());
+        return 1;
+    }
+
+    printf("%s: %.1f MB in %.1f s on %d threads\n", outPath.c_str(), table.bytes() / 1e6, seconds, threads);
+
+    return 0;
+}
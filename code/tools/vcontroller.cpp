@@ -0,0 +1,237 @@
+// 5bar_vcontroller [--baud n] [--depth n] [--hz n] [--corrupt p] [--seconds n]
+//
+// stands in for the motor controller on a pseudo terminal. prints the
+// device to open, then reads setpoint frames no faster than the baud rate
+// carries them, holds them in a queue of --depth setpoints and plays one
+// every control tick, answering with credits the way the firmware does.
+// --corrupt flips a bit in that fraction of the received bytes, to put
+// the crc and the resends to work. once a second it reports the queue and
+// the link on stderr, and a summary on stdout when it stops
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "protocol.h"
+
+static volatile sig_atomic_t stopping = 0;
+
+static void Stop(int)
+{
+    stopping = 1;
+}
+
+// one byte is 10 bits on the wire with start and stop bits
+static double BytesPerTick(int baud, int hz)
+{
+    return baud / 10.0 / hz;
+}
+
+int main(int argc, char** argv)
+{
+    int baud = 115200;
+    int depth = 256;
+    int hz = 1000;
+    double corrupt = 0;
+    double seconds = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--baud") && i + 1 < argc) baud = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hz") && i + 1 < argc) hz = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--corrupt") && i + 1 < argc) corrupt = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--baud n] [--depth n] [--hz n] [--corrupt p] [--seconds n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (baud <= 0 || hz <= 0 || depth < BATCH_SETPOINTS || depth > 65535)
+    {
+        fprintf(stderr, "need a positive baud and rate, and a depth of %d to 65535\n", BATCH_SETPOINTS);
+        return 2;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+
+    const char* name = ptsname(master);
+
+    // held open so the master does not see a hangup between clients, and
+    // raw from the start so nothing the host sends is echoed or cooked
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    termios t;
+    tcgetattr(slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    printf("%s\n", name);
+    fflush(stdout);
+
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+
+    std::vector<WireSetpoint> queue(depth);
+    int head = 0, count = 0;
+
+    FrameParser parser;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> chance(0, 1);
+
+    uint8_t expected = 0;
+    bool owed = false;          // the last batch taken did not end its trajectory
+    WireSetpoint pose = {};
+
+    uint16_t underruns = 0;
+    uint64_t played = 0, frames = 0, naks = 0, overflows = 0, received = 0;
+    int minDepth = -1;
+
+    std::vector<uint8_t> tx;
+    uint8_t frame[FRAME_OVERHEAD + FRAME_PAYLOAD_MAX];
+    WireSetpoint batch[BATCH_SETPOINTS];
+
+    const double perTick = BytesPerTick(baud, hz);
+    double rxBudget = 0, txBudget = 0;
+
+    const auto tick = std::chrono::nanoseconds(1000000000 / hz);
+    auto next = std::chrono::steady_clock::now();
+    auto lastNak = next - std::chrono::seconds(1);
+
+    uint64_t ticks = 0, sinceCredit = 0;
+    uint64_t limit = seconds > 0 ? (uint64_t)(seconds * hz) : 0;
+
+    auto Credit = [&]
+    {
+        CreditReport r = {(uint8_t)(expected - 1), (uint16_t)(depth - count), (uint16_t)count, underruns};
+        size_t size = EncodeCredit(r, frame);
+        tx.insert(tx.end(), frame, frame + size);
+        sinceCredit = 0;
+    };
+
+    while (!stopping && (!limit || ticks < limit))
+    {
+        next += tick;
+        std::this_thread::sleep_until(next);
+        ticks++;
+        sinceCredit++;
+
+        // the line carries at most perTick bytes, an idle line banks nothing
+        rxBudget += perTick;
+        int want = (int)rxBudget;
+        uint8_t bytes[256];
+        ssize_t n = want ? read(master, bytes, std::min(want, (int)sizeof(bytes))) : 0;
+        if (n < 0) n = 0;
+        rxBudget -= n < want ? want : n;
+        received += n;
+
+        bool answer = false;
+
+        for (ssize_t i = 0; i < n; i++)
+        {
+            uint8_t b = bytes[i];
+            if (corrupt > 0 && chance(rng) < corrupt) b ^= (uint8_t)(1 << (rng() & 7));
+
+            if (!parser.feed(b)) continue;
+
+            const Frame& f = parser.frame();
+            uint8_t flags;
+            int got;
+
+            if (f.type == FRAME_RESET)
+            {
+                head = count = 0;
+                expected = (uint8_t)(f.seq + 1);
+                owed = false;
+                answer = true;
+            }
+            else if (DecodeSetpoints(f, flags, batch, got))
+            {
+                if (f.seq == expected && got <= depth - count)
+                {
+                    for (int k = 0; k < got; k++) queue[(head + count + k) % depth] = batch[k];
+
+                    count += got;
+                    expected++;
+                    owed = !(flags & SETPOINTS_END);
+                    frames++;
+                    answer = true;
+                }
+                else if ((uint8_t)(expected - f.seq) < 128 && f.seq != expected)
+                {
+                    // a resent frame already taken, the credit tells the host
+                    answer = true;
+                }
+                else
+                {
+                    // a gap, or more than the credits allowed
+                    if (f.seq == expected) overflows++;
+
+                    auto now = std::chrono::steady_clock::now();
+                    if (now - lastNak > std::chrono::milliseconds(10))
+                    {
+                        size_t size = EncodeFrame(FRAME_NAK, expected, nullptr, 0, frame);
+                        tx.insert(tx.end(), frame, frame + size);
+                        lastNak = now;
+                        naks++;
+                    }
+                }
+            }
+        }
+
+        // one setpoint a tick, holding the last pose when the queue is empty
+        if (count)
+        {
+            pose = queue[head];
+            head = (head + 1) % depth;
+            count--;
+            played++;
+        }
+        else if (owed) underruns++;
+
+        if (owed) minDepth = minDepth < 0 ? count : std::min(minDepth, count);
+
+        if (answer || sinceCredit >= 5) Credit();
+
+        txBudget += perTick;
+        int room = (int)txBudget;
+        ssize_t w = room && !tx.empty() ? write(master, tx.data(), std::min((size_t)room, tx.size())) : 0;
+        if (w < 0) w = 0;
+        tx.erase(tx.begin(), tx.begin() + w);
+        txBudget -= w < room ? room : w;
+
+        if (ticks % hz == 0)
+        {
+            fprintf(stderr, "%5.1f s  depth %3d  min %3d  played %llu  underruns %u  frames %llu  naks %llu  crc errors %u  %.0f B/s\n",
+                    ticks / (double)hz, count, minDepth, (unsigned long long)played, underruns,
+                    (unsigned long long)frames, (unsigned long long)naks, parser.crcErrors(),
+                    received / (ticks / (double)hz));
+        }
+    }
+
+    printf("played %llu setpoints in %.1f s, %llu frames, %u underruns, min depth %d, %llu naks, %u crc errors, "
+           "%llu over the credits, at %d %d\n",
+           (unsigned long long)played, ticks / (double)hz, (unsigned long long)frames, underruns, minDepth,
+           (unsigned long long)naks, parser.crcErrors(), (unsigned long long)overflows, pose.theta1, pose.theta2);
+
+    close(slave);
+    close(master);
+
+    return 0;
+}